@@ -2,6 +2,7 @@
 #include <stdint.h>
 #include "../console.h"
 #include "../vga.h"
+#include "../lib/string.h"
 
 #define MAX_SCREEN_W 160
 #define MAX_SCREEN_H 64
@@ -23,9 +24,11 @@ static const char shades[] = ".,-~:;=!*#$@";
 
 #define FRAME_CELLS (MAX_SCREEN_W * MAX_SCREEN_H)
 #define GFX_FRAME_CELLS (MAX_GFX_W * MAX_GFX_H)
+#define GFX_BAND_PIXELS (1280 * 32)
 
 static uint16_t g_char_prev[FRAME_CELLS];
 static int g_char_prev_init = 0;
+static uint32_t g_gfx_band[GFX_BAND_PIXELS];
 
 static const int16_t sin_q[65] = {
     0, 402, 803, 1205, 1605, 2005, 2404, 2801, 3196, 3589, 3980, 4369, 4755,
@@ -92,6 +95,13 @@ static void frame_copy_to_screen(const uint16_t* frame, uint16_t cols, uint16_t
     }
 }
 
+static uint32_t graphics_shade(uint8_t lum) {
+    if (lum == 0) return 0;
+    uint32_t c = 18u + (uint32_t)lum * 18u;
+    if (c > 255u) c = 255u;
+    return (c << 16) | ((c + 12u > 255u ? 255u : c + 12u) << 8) | c;
+}
+
 static void frame_copy_to_screen_graphics(const uint8_t* lumframe, uint16_t cols, uint16_t rows) {
     uint16_t pixel_w = vga_pixel_width();
     uint16_t pixel_h = vga_pixel_height();
@@ -100,19 +110,39 @@ static void frame_copy_to_screen_graphics(const uint8_t* lumframe, uint16_t cols
 
     if (cell_w == 0 || cell_h == 0) return;
 
-    for (uint16_t y = 0; y < rows; y++) {
-        for (uint16_t x = 0; x < cols; x++) {
-            uint8_t lum = lumframe[y * cols + x];
-            uint32_t shade = 0;
-
-            if (lum != 0) {
-                uint32_t c = 18u + (uint32_t)lum * 18u;
-                if (c > 255u) c = 255u;
-                shade = (c << 16) | ((c + 12u > 255u ? 255u : c + 12u) << 8) | c;
+    uint32_t span_w = (uint32_t)cols * cell_w;
+    uint32_t band_rows = GFX_BAND_PIXELS / (span_w * cell_h);
+    if (band_rows == 0) {
+        /* One cell row does not fit the band buffer; draw the cells directly. */
+        for (uint16_t y = 0; y < rows; y++) {
+            for (uint16_t x = 0; x < cols; x++) {
+                vga_fill_rect((uint16_t)(x * cell_w), (uint16_t)(y * cell_h), cell_w, cell_h,
+                              graphics_shade(lumframe[y * cols + x]));
             }
+        }
+        return;
+    }
 
-            vga_fill_rect((uint16_t)(x * cell_w), (uint16_t)(y * cell_h), cell_w, cell_h, shade);
+    for (uint16_t y0 = 0; y0 < rows; y0 = (uint16_t)(y0 + band_rows)) {
+        uint16_t y1 = (uint16_t)(y0 + band_rows < rows ? y0 + band_rows : rows);
+
+        for (uint16_t y = y0; y < y1; y++) {
+            uint32_t* line = g_gfx_band + (uint32_t)(y - y0) * cell_h * span_w;
+
+            for (uint16_t x = 0; x < cols; x++) {
+                uint32_t shade = graphics_shade(lumframe[y * cols + x]);
+
+                for (uint16_t px = 0; px < cell_w; px++) {
+                    line[(uint32_t)x * cell_w + px] = shade;
+                }
+            }
+            for (uint16_t py = 1; py < cell_h; py++) {
+                kmemcpy(line + (uint32_t)py * span_w, line, span_w * sizeof(uint32_t));
+            }
         }
+
+        vga_blit(0, (uint16_t)(y0 * cell_h), (uint16_t)span_w, (uint16_t)((y1 - y0) * cell_h),
+                 g_gfx_band, span_w);
     }
 }
 
@@ -0,0 +1,105 @@
+#include "cpu.h"
+
+#define EFLAGS_ID (1u << 21)
+
+static cpu_info_t g_cpu;
+
+static void cpuid(uint32_t leaf, uint32_t sub, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d) {
+    __asm__ volatile ("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "a"(leaf), "c"(sub));
+}
+
+/* CPUID exists iff EFLAGS.ID can be toggled (absent on early 486s). */
+static int cpuid_supported(void) {
+    uint32_t before, after;
+    __asm__ volatile (
+        "pushfl\n\t"
+        "popl %0\n\t"
+        "movl %0, %1\n\t"
+        "xorl %2, %1\n\t"
+        "pushl %1\n\t"
+        "popfl\n\t"
+        "pushfl\n\t"
+        "popl %1\n\t"
+        "pushl %0\n\t"
+        "popfl"
+        : "=&r"(before), "=&r"(after)
+        : "i"(EFLAGS_ID)
+        : "cc");
+    return ((before ^ after) & EFLAGS_ID) != 0;
+}
+
+static void put_reg(char* out, uint32_t r) {
+    for (int i = 0; i < 4; i++) out[i] = (char)(r >> (8 * i));
+}
+
+void cpu_init(void) {
+    uint32_t a, b, c, d;
+
+    g_cpu.vendor[0] = '\0';
+    g_cpu.brand[0] = '\0';
+    g_cpu.flags = 0;
+    g_cpu.cache_line = 0;
+    if (!cpuid_supported()) return;
+
+    cpuid(0, 0, &a, &b, &c, &d);
+    uint32_t max_leaf = a;
+    put_reg(g_cpu.vendor, b);
+    put_reg(g_cpu.vendor + 4, d);
+    put_reg(g_cpu.vendor + 8, c);
+    g_cpu.vendor[12] = '\0';
+    if (max_leaf < 1) return;
+
+    cpuid(1, 0, &a, &b, &c, &d);
+    g_cpu.stepping = a & 0xFu;
+    g_cpu.model = (a >> 4) & 0xFu;
+    g_cpu.family = (a >> 8) & 0xFu;
+    if (g_cpu.family == 0xF) g_cpu.family += (a >> 20) & 0xFFu;
+    if (g_cpu.family >= 0x6) g_cpu.model |= ((a >> 16) & 0xFu) << 4;
+    if (d & (1u << 19)) g_cpu.cache_line = ((b >> 8) & 0xFFu) * 8u;
+
+    if (d & (1u << 0))  g_cpu.flags |= CPU_FPU;
+    if (d & (1u << 3))  g_cpu.flags |= CPU_PSE;
+    if (d & (1u << 4))  g_cpu.flags |= CPU_TSC;
+    if (d & (1u << 9))  g_cpu.flags |= CPU_APIC;
+    if (d & (1u << 13)) g_cpu.flags |= CPU_PGE;
+    if (d & (1u << 16)) g_cpu.flags |= CPU_PAT;
+    if (d & (1u << 24)) g_cpu.flags |= CPU_FXSR;
+    if (d & (1u << 25)) g_cpu.flags |= CPU_SSE;
+    if (d & (1u << 26)) g_cpu.flags |= CPU_SSE2;
+    if (c & (1u << 20)) g_cpu.flags |= CPU_SSE42;
+
+    if (max_leaf >= 7) {
+        cpuid(7, 0, &a, &b, &c, &d);
+        if (b & (1u << 9)) g_cpu.flags |= CPU_ERMS;
+    }
+
+    cpuid(0x80000000u, 0, &a, &b, &c, &d);
+    uint32_t max_ext = a;
+    if (max_ext >= 0x80000004u) {
+        for (uint32_t i = 0; i < 3; i++) {
+            cpuid(0x80000002u + i, 0, &a, &b, &c, &d);
+            char* out = g_cpu.brand + i * 16u;
+            put_reg(out, a);
+            put_reg(out + 4, b);
+            put_reg(out + 8, c);
+            put_reg(out + 12, d);
+        }
+        g_cpu.brand[48] = '\0';
+    }
+    if (max_ext >= 0x80000006u && g_cpu.cache_line == 0) {
+        cpuid(0x80000006u, 0, &a, &b, &c, &d);
+        g_cpu.cache_line = c & 0xFFu;
+    }
+    if (max_ext >= 0x80000007u) {
+        cpuid(0x80000007u, 0, &a, &b, &c, &d);
+        if (d & (1u << 8)) g_cpu.flags |= CPU_TSC_INV;
+    }
+}
+
+const cpu_info_t* cpu_info(void) {
+    return &g_cpu;
+}
+
+int cpu_has(uint32_t flags) {
+    return (g_cpu.flags & flags) == flags;
+}
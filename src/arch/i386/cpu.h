@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+
+#define CPU_FPU      (1u << 0)
+#define CPU_PSE      (1u << 1)
+#define CPU_TSC      (1u << 2)
+#define CPU_APIC     (1u << 3)
+#define CPU_PGE      (1u << 4)
+#define CPU_PAT      (1u << 5)
+#define CPU_FXSR     (1u << 6)
+#define CPU_SSE      (1u << 7)
+#define CPU_SSE2     (1u << 8)
+#define CPU_SSE42    (1u << 9)
+#define CPU_ERMS     (1u << 10)
+#define CPU_TSC_INV  (1u << 11)
+
+typedef struct {
+    char     vendor[13];
+    char     brand[49];
+    uint32_t family;
+    uint32_t model;
+    uint32_t stepping;
+    uint32_t cache_line;
+    uint32_t flags;
+} cpu_info_t;
+
+void              cpu_init(void);
+const cpu_info_t* cpu_info(void);
+int               cpu_has(uint32_t flags);
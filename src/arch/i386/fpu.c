@@ -0,0 +1,49 @@
+#include "fpu.h"
+#include "cpu.h"
+
+#define CR0_MP         (1u << 1)
+#define CR0_EM         (1u << 2)
+#define CR0_TS         (1u << 3)
+#define CR4_OSFXSR     (1u << 9)
+#define CR4_OSXMMEXCPT (1u << 10)
+
+/* Nonzero while kernel code owns the SSE registers; irq_common_stub
+   FXSAVEs around the handler only in that case. */
+volatile uint32_t fpu_kernel_depth;
+
+static uint32_t g_features;
+
+uint32_t fpu_init(void) {
+    if (!cpu_has(CPU_FXSR | CPU_SSE)) return 0;
+
+    uint32_t cr0, cr4;
+    __asm__ volatile ("mov %%cr0, %0" : "=r"(cr0));
+    cr0 &= ~(CR0_EM | CR0_TS);
+    cr0 |= CR0_MP;
+    __asm__ volatile ("mov %0, %%cr0" : : "r"(cr0));
+
+    __asm__ volatile ("mov %%cr4, %0" : "=r"(cr4));
+    cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+    __asm__ volatile ("mov %0, %%cr4" : : "r"(cr4));
+
+    uint32_t mxcsr = 0x1F80u;
+    __asm__ volatile ("fninit\n\tldmxcsr %0" : : "m"(mxcsr));
+
+    g_features = FPU_SSE;
+    if (cpu_has(CPU_SSE2)) g_features |= FPU_SSE2;
+    return g_features;
+}
+
+uint32_t fpu_features(void) {
+    return g_features;
+}
+
+int kernel_fpu_begin(void) {
+    if (!g_features) return 0;
+    fpu_kernel_depth++;
+    return 1;
+}
+
+void kernel_fpu_end(void) {
+    if (fpu_kernel_depth > 0) fpu_kernel_depth--;
+}
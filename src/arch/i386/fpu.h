@@ -0,0 +1,10 @@
+#pragma once
+#include <stdint.h>
+
+#define FPU_SSE  0x1u
+#define FPU_SSE2 0x2u
+
+uint32_t fpu_init(void);
+uint32_t fpu_features(void);
+int  kernel_fpu_begin(void);
+void kernel_fpu_end(void);
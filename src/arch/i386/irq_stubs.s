@@ -1,6 +1,7 @@
 BITS 32
 
 extern irq_handler
+extern fpu_kernel_depth
 global irq0, irq1, irq2, irq3, irq4, irq5, irq6, irq7
 global irq8, irq9, irq10, irq11, irq12, irq13, irq14, irq15
 
@@ -31,6 +32,7 @@ IRQ_STUB 15, 47
 
 irq_common_stub:
     pusha
+    cld
 
     mov ax, ds
     push eax
@@ -41,10 +43,25 @@ irq_common_stub:
     mov fs, ax
     mov gs, ax
 
-    push esp
+    mov ebx, esp
+    xor esi, esi
+    cmp dword [fpu_kernel_depth], 0
+    je .call
+    sub esp, 512
+    and esp, 0xFFFFFFF0
+    fxsave [esp]
+    inc esi
+.call:
+    push ebx
     call irq_handler
     add esp, 4
 
+    test esi, esi
+    jz .restored
+    fxrstor [esp]
+.restored:
+    mov esp, ebx
+
     pop eax
     mov ds, ax
     mov es, ax
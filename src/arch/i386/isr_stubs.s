@@ -58,6 +58,7 @@ ISR_NOERR 31
 
 isr_common_stub:
     pusha
+    cld
 
     mov ax, ds
     push eax
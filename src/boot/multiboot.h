@@ -3,6 +3,7 @@
 #include <stdint.h>
 
 #define MB_BOOTLOADER_MAGIC 0x2BADB002u
+#define MB_INFO_MEMORY      (1u << 0)
 #define MB_INFO_MODS        (1u << 3)
 #define MB_INFO_FRAMEBUFFER (1u << 12)
 
@@ -1,37 +1,186 @@
 #include "print.h"
 #include "../vga.h"
 
+#define KPRINTF_BUF 256
+
+typedef struct {
+    char*  buf;
+    size_t cap;
+    size_t len;
+    size_t total;
+    int    console;
+} fmt_out_t;
+
+static void out_char(fmt_out_t* o, char c) {
+    o->total++;
+    if (o->console) {
+        if (o->len == o->cap) {
+            vga_write(o->buf, o->len);
+            o->len = 0;
+        }
+        o->buf[o->len++] = c;
+    } else if (o->len + 1 < o->cap) {
+        o->buf[o->len++] = c;
+    }
+}
+
+static void out_pad(fmt_out_t* o, char c, int n) {
+    while (n-- > 0) out_char(o, c);
+}
+
+static void out_field(fmt_out_t* o, const char* s, int len, int width, int left, char pad) {
+    if (!left && pad == '0' && (*s == '-') && len > 0) {
+        out_char(o, *s++);
+        len--;
+        width--;
+    }
+    if (!left) out_pad(o, pad, width - len);
+    for (int i = 0; i < len; i++) out_char(o, s[i]);
+    if (left) out_pad(o, ' ', width - len);
+}
+
+static int fmt_uint(char* out, uint32_t v, uint32_t base, int upper) {
+    const char* digits = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    char tmp[11];
+    int n = 0;
+
+    do {
+        tmp[n++] = digits[v % base];
+        v /= base;
+    } while (v);
+
+    for (int i = 0; i < n; i++) out[i] = tmp[n - 1 - i];
+    return n;
+}
+
+static void format(fmt_out_t* o, const char* fmt, va_list ap) {
+    char num[12];
+
+    while (*fmt) {
+        if (*fmt != '%') {
+            out_char(o, *fmt++);
+            continue;
+        }
+        fmt++;
+
+        int left = 0;
+        char pad = ' ';
+        for (;; fmt++) {
+            if (*fmt == '-') left = 1;
+            else if (*fmt == '0') pad = '0';
+            else break;
+        }
+
+        int width = 0;
+        if (*fmt == '*') {
+            width = va_arg(ap, int);
+            if (width < 0) {
+                left = 1;
+                width = -width;
+            }
+            fmt++;
+        }
+        while (*fmt >= '0' && *fmt <= '9') width = width * 10 + (*fmt++ - '0');
+
+        int prec = -1;
+        if (*fmt == '.') {
+            fmt++;
+            prec = 0;
+            while (*fmt >= '0' && *fmt <= '9') prec = prec * 10 + (*fmt++ - '0');
+        }
+        while (*fmt == 'l' || *fmt == 'h' || *fmt == 'z') fmt++;
+        if (left) pad = ' ';
+
+        switch (*fmt) {
+            case 'd':
+            case 'i': {
+                int32_t v = va_arg(ap, int32_t);
+                int n = 0;
+                if (v < 0) num[n++] = '-';
+                n += fmt_uint(num + n, v < 0 ? 0u - (uint32_t)v : (uint32_t)v, 10, 0);
+                out_field(o, num, n, width, left, pad);
+                break;
+            }
+            case 'u':
+                out_field(o, num, fmt_uint(num, va_arg(ap, uint32_t), 10, 0), width, left, pad);
+                break;
+            case 'x':
+            case 'X':
+                out_field(o, num, fmt_uint(num, va_arg(ap, uint32_t), 16, *fmt == 'X'),
+                          width, left, pad);
+                break;
+            case 'p':
+                out_char(o, '0');
+                out_char(o, 'x');
+                out_field(o, num, fmt_uint(num, (uint32_t)(uintptr_t)va_arg(ap, void*), 16, 0),
+                          width > 2 ? width - 2 : 0, left, '0');
+                break;
+            case 'c':
+                num[0] = (char)va_arg(ap, int);
+                out_field(o, num, 1, width, left, ' ');
+                break;
+            case 's': {
+                const char* s = va_arg(ap, const char*);
+                int n = 0;
+                if (!s) s = "(null)";
+                while (s[n] && (prec < 0 || n < prec)) n++;
+                out_field(o, s, n, width, left, ' ');
+                break;
+            }
+            case '%':
+                out_char(o, '%');
+                break;
+            case '\0':
+                return;
+            default:
+                out_char(o, '%');
+                out_char(o, *fmt);
+                break;
+        }
+        fmt++;
+    }
+}
+
+int kvsnprintf(char* buf, size_t size, const char* fmt, va_list ap) {
+    fmt_out_t o = {buf, size, 0, 0, 0};
+    format(&o, fmt, ap);
+    if (size) buf[o.len] = '\0';
+    return (int)o.total;
+}
+
+int ksnprintf(char* buf, size_t size, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = kvsnprintf(buf, size, fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+/* Formats into a stack buffer and hands the console whole chunks, so a
+   typical line costs one vga_write and one cursor update. */
+int kprintf(const char* fmt, ...) {
+    char buf[KPRINTF_BUF];
+    fmt_out_t o = {buf, sizeof(buf), 0, 0, 1};
+    va_list ap;
+
+    va_start(ap, fmt);
+    format(&o, fmt, ap);
+    va_end(ap);
+    vga_write(buf, o.len);
+    return (int)o.total;
+}
+
 void kprint(const char* s) { vga_puts(s); }
 void kprint_char(char c) { vga_putc(c); }
 
 void kprint_hex8(uint8_t v) {
-    const char* hex = "0123456789ABCDEF";
-    vga_putc(hex[(v >> 4) & 0xF]);
-    vga_putc(hex[v & 0xF]);
+    kprintf("%02X", v);
 }
 
 void kprint_hex32(uint32_t v) {
-    kprint("0x");
-    kprint_hex8((v >> 24) & 0xFF);
-    kprint_hex8((v >> 16) & 0xFF);
-    kprint_hex8((v >> 8) & 0xFF);
-    kprint_hex8(v & 0xFF);
+    kprintf("0x%08X", v);
 }
 
 void kprint_dec(uint32_t v) {
-    char buf[11];
-    int i = 0;
-
-    if (v == 0) {
-        vga_putc('0');
-        return;
-    }
-
-    while (v > 0 && i < 10) {
-        buf[i++] = (char)('0' + (v % 10));
-        v /= 10;
-    }
-    while (i--) {
-        vga_putc(buf[i]);
-    }
+    kprintf("%u", v);
 }
@@ -1,4 +1,6 @@
 #pragma once
+#include <stdarg.h>
+#include <stddef.h>
 #include <stdint.h>
 
 void kprint(const char* s);
@@ -6,3 +8,10 @@ void kprint_char(char c);
 void kprint_hex8(uint8_t v);
 void kprint_hex32(uint32_t v);
 void kprint_dec(uint32_t v);
+
+/* Supports %d %i %u %x %X %p %c %s %% with '-'/'0' flags, a width (or *)
+   and a precision for %s. Arguments are 32-bit; l/h/z are accepted and
+   ignored, 64-bit values are not supported. */
+int kprintf(const char* fmt, ...);
+int ksnprintf(char* buf, size_t size, const char* fmt, ...);
+int kvsnprintf(char* buf, size_t size, const char* fmt, va_list ap);
@@ -24,6 +24,8 @@
 
 #define ATA_CMD_IDENTIFY  0xEC
 #define ATA_CMD_READ_PIO  0x20
+#define ATA_CMD_WRITE_PIO 0x30
+#define ATA_CMD_FLUSH     0xE7
 
 static ata_device_t g_dev;
 
@@ -42,6 +44,15 @@ static int ata_wait_not_busy(void) {
     return -1;
 }
 
+static int ata_wait_ready(void) {
+    for (int i = 0; i < 1000000; i++) {
+        uint8_t s = inb(ATA_IO_BASE + ATA_REG_STATUS);
+        if (s & ATA_SR_BSY) continue;
+        return (s & (ATA_SR_ERR | ATA_SR_DF)) ? -1 : 0;
+    }
+    return -1;
+}
+
 static int ata_wait_drq_or_err(void) {
     for (int i = 0; i < 100000; i++) {
         uint8_t s = inb(ATA_IO_BASE + ATA_REG_STATUS);
@@ -156,3 +167,44 @@ int ata_read28(uint32_t lba, uint8_t count, void* out) {
 
     return 0;
 }
+
+
+int ata_write28(uint32_t lba, uint8_t count, const void* in) {
+    if (!g_dev.present) return -1;
+    if (count == 0) return 0;
+    if (lba > 0x0FFFFFFF) return -1;
+
+    const uint8_t* buf = (const uint8_t*)in;
+
+    if (ata_wait_not_busy() != 0) return -1;
+
+    ata_select_primary_master(lba);
+
+    outb(ATA_IO_BASE + ATA_REG_SECCOUNT0, count);
+    outb(ATA_IO_BASE + ATA_REG_LBA0, (uint8_t)(lba & 0xFF));
+    outb(ATA_IO_BASE + ATA_REG_LBA1, (uint8_t)((lba >> 8) & 0xFF));
+    outb(ATA_IO_BASE + ATA_REG_LBA2, (uint8_t)((lba >> 16) & 0xFF));
+    outb(ATA_IO_BASE + ATA_REG_COMMAND, ATA_CMD_WRITE_PIO);
+
+    for (uint8_t s = 0; s < count; s++) {
+        if (ata_wait_drq_or_err() != 0) return -1;
+
+        for (int i = 0; i < 256; i++) {
+            uint16_t w = (uint16_t)buf[0] | ((uint16_t)buf[1] << 8);
+            outw(ATA_IO_BASE + ATA_REG_DATA, w);
+            buf += 2;
+        }
+    }
+
+    return ata_wait_ready();
+}
+
+int ata_flush(void) {
+    if (!g_dev.present) return -1;
+    if (ata_wait_not_busy() != 0) return -1;
+
+    ata_select_primary_master(0);
+    outb(ATA_IO_BASE + ATA_REG_COMMAND, ATA_CMD_FLUSH);
+    ata_delay_400ns();
+    return ata_wait_ready();
+}
\ No newline at end of file
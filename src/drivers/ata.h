@@ -7,6 +7,8 @@ typedef struct {
     char model[41];
 } ata_device_t;
 
+#define ATA_MAX_SECTORS 255u
+
 void ata_init(void);
 
 int ata_present(void);
@@ -14,3 +16,8 @@ int ata_present(void);
 const char* ata_model(void);
 
 int ata_read28(uint32_t lba, uint8_t count, void* out);
+
+int ata_write28(uint32_t lba, uint8_t count, const void* in);
+
+/* Drains the drive's write cache; call at ordering points, not per write. */
+int ata_flush(void);
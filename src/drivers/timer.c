@@ -1,11 +1,13 @@
 #include "timer.h"
 #include "../arch/i386/io.h"
 #include "../arch/i386/irq.h"
+#include "../arch/i386/cpu.h"
 #include "../debug/print.h"
 
 static volatile uint32_t ticks = 0;
 static volatile uint32_t seconds = 0;
 static uint32_t hz_local = 100;
+static uint32_t tsc_per_us = 0;
 
 static void timer_callback(struct regs* r) {
     (void)r;
@@ -19,6 +21,48 @@ static void timer_callback(struct regs* r) {
 uint32_t timer_ticks(void) { return ticks; }
 uint32_t timer_seconds(void) { return seconds; }
 
+/* Without a TSC the "cycle" counter falls back to PIT ticks scaled to
+   microseconds, and timer_cycles_per_us reports 1. */
+uint64_t timer_cycles(void) {
+    if (!cpu_has(CPU_TSC)) return (uint64_t)ticks * (1000000u / hz_local);
+
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+uint32_t timer_cycles_per_us(void) {
+    if (tsc_per_us) return tsc_per_us;
+    if (!cpu_has(CPU_TSC)) {
+        tsc_per_us = 1;
+        return tsc_per_us;
+    }
+
+    uint32_t span = hz_local / 10u;
+    if (span == 0) span = 1;
+    uint32_t t = ticks;
+    while (ticks == t) __asm__ volatile ("pause");
+
+    uint64_t start = timer_cycles();
+    t = ticks;
+    while (ticks - t < span) __asm__ volatile ("pause");
+
+    uint32_t us = span * (1000000u / hz_local);
+    tsc_per_us = (uint32_t)(timer_cycles() - start) / us;
+    if (tsc_per_us == 0) tsc_per_us = 1;
+    return tsc_per_us;
+}
+
+uint32_t timer_us_since(uint64_t start) {
+    uint64_t d = timer_cycles() - start;
+    uint32_t shift = 0;
+    while (d >> 32) {
+        d >>= 1;
+        shift++;
+    }
+    return ((uint32_t)d / timer_cycles_per_us()) << shift;
+}
+
 void timer_init(uint32_t hz) {
     hz_local = hz ? hz : 100;
     irq_register_handler(0, timer_callback);
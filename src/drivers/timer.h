@@ -4,3 +4,6 @@
 void timer_init(uint32_t hz);
 uint32_t timer_ticks(void);
 uint32_t timer_seconds(void);
+uint64_t timer_cycles(void);
+uint32_t timer_cycles_per_us(void);
+uint32_t timer_us_since(uint64_t start);
@@ -1,4 +1,6 @@
 #include "fat16.h"
+#include "vfs.h"
+#include "pcache.h"
 #include "../drivers/ata.h"
 #include "../debug/print.h"
 #include "../vga.h"
@@ -14,7 +16,14 @@ typedef struct {
     uint16_t reserved_sectors;
     uint8_t  num_fats;
     uint16_t root_entry_count;
-    uint16_t fat_size_sectors;   
+    uint32_t fat_size_sectors;   
+    uint32_t total_sectors;
+    uint32_t cluster_count;
+
+    int fat32;
+    uint32_t eoc;
+    uint32_t root_cluster;
+    uint32_t fsinfo_lba;
 
     uint32_t fat_lba;            
     uint32_t root_dir_lba;
@@ -22,7 +31,135 @@ typedef struct {
     uint32_t first_data_lba;
 } fat16_t;
 
-static fat16_t g_fat;
+#define FAT16_FAT_CACHE_SECTORS 256u
+#define FAT16_IO_BUF_SECTORS    64u
+#define FAT16_DIRCACHE_MAX      4096u
+#define FAT16_DIRCACHE_BUCKETS  8192u
+#define FAT16_DENTRY_MAX        256u
+#define FAT16_DENTRY_BUCKETS    512u
+#define FAT16_OPEN_MAX          8u
+#define FAT16_OPEN_INDEX        8192u
+#define FAT16_DIRNODE_MAX       16u
+#define FAT16_READAHEAD         8192u
+#define FAT16_DEFRAG_BATCH      32u
+#define FAT16_DEFRAG_DEPTH      16u
+#define FAT16_DEFRAG_PATH       96u
+#define FAT16_MAX_CLUSTERS      0xFFF4u
+#define FAT16_EOC               0xFFFFu
+#define FAT16_DIR_END           0xFFFFFFFFu
+#define FAT32_MAX_CLUSTERS      0x0FFFFFF4u
+#define FAT32_EOC               0x0FFFFFFFu
+#define FAT32_MASK              0x0FFFFFFFu
+#define FAT32_FSINFO_UNKNOWN    0xFFFFFFFFu
+#define FAT_NEXT_ERR            0xFFFFFFFFu
+#define FAT32_CHUNK_SECTORS     FAT16_IO_BUF_SECTORS
+#define FAT32_CHUNK_CLUSTERS    (FAT32_CHUNK_SECTORS * 128u)
+#define FAT32_CHUNK_MAX         ((FAT32_MAX_CLUSTERS + 2u + FAT32_CHUNK_CLUSTERS - 1u) / FAT32_CHUNK_CLUSTERS)
+
+#define FAT_ATTR_VOLUME 0x08
+#define FAT_ATTR_DIR    0x10
+#define FAT_ATTR_LFN    0x0F
+
+typedef struct {
+    uint8_t  name[11];
+    uint8_t  attr;
+    uint32_t first_cluster;
+    uint16_t ent_off;
+    uint32_t ent_lba;
+    uint32_t size;
+    uint32_t hash;
+} fat16_dirent_t;
+
+typedef struct {
+    fat16_dirent_t ent;
+    uint32_t parent;
+    uint16_t hnext;
+    uint16_t prev;
+    uint16_t next;
+} fat16_dentry_t;
+
+typedef int (*dir_visit_fn)(const fat16_dirent_t* d, void* ctx);
+
+typedef struct {
+    vfs_node_t node;
+    fat16_volume_t* vol;
+    uint32_t cluster;
+    uint32_t hint_index;
+    uint32_t hint_cluster;
+} fat16_dirnode_t;
+
+struct fat16_volume {
+    char name[FAT16_NAME_MAX];
+    char mount_path[VFS_MOUNT_PATH];
+    fat16_dirnode_t root_node;
+    uint32_t dev;
+
+    fat16_t fat;
+
+    uint8_t fat_cache[FAT16_FAT_CACHE_SECTORS * 512u];
+    uint8_t fat_cache_loaded[FAT16_FAT_CACHE_SECTORS / 8u];
+    uint8_t fat_cache_dirty[FAT16_FAT_CACHE_SECTORS / 8u];
+    uint32_t fat_cache_tag[FAT16_FAT_CACHE_SECTORS];
+    uint32_t used_map[(FAT16_MAX_CLUSTERS + 2u + 31u) / 32u];
+    uint32_t chunk_free[(FAT32_CHUNK_MAX + 31u) / 32u];
+    uint32_t free_count;
+    uint32_t next_free;
+    int fsinfo_dirty;
+    int disk_dirty;
+    fat16_stats_t stats;
+
+    fat16_dirent_t dir[FAT16_DIRCACHE_MAX];
+    uint16_t dir_buckets[FAT16_DIRCACHE_BUCKETS];
+    uint32_t dir_count;
+    int dir_valid;
+    int dir_overflow;
+
+    fat16_dentry_t dentries[FAT16_DENTRY_MAX];
+    uint16_t dentry_buckets[FAT16_DENTRY_BUCKETS];
+    uint16_t dentry_count;
+    uint16_t lru_head;
+    uint16_t lru_tail;
+};
+
+typedef struct {
+    fat16_volume_t* vol;
+    uint32_t first_cluster;
+    uint32_t size;
+    uint32_t cur_cluster;
+    uint32_t cur_index;
+    uint32_t* index;
+    uint32_t index_cap;
+    uint32_t index_known;
+} fat16_file_t;
+
+typedef struct {
+    int in_use;
+    uint32_t ent_lba;
+    uint16_t ent_off;
+    fat16_dirent_t ent;
+    int ent_dirty;
+    vfs_node_t node;
+    fat16_file_t file;
+    vfs_advice_t advice;
+    uint32_t last_end;
+    uint32_t ra_off;
+    uint32_t ra_len;
+    uint8_t ra[FAT16_READAHEAD];
+    uint32_t index[FAT16_OPEN_INDEX];
+} fat16_open_t;
+
+static fat16_volume_t g_vols[FAT16_MAX_VOLUMES];
+
+static uint8_t g_io_buf[FAT16_IO_BUF_SECTORS * 512u];
+static uint8_t g_edge_sec[512];
+static uint8_t g_dir_sec[512];
+static uint8_t g_readdir_sec[512];
+static uint32_t g_readdir_lba;
+static int g_readdir_valid;
+
+static fat16_open_t g_open[FAT16_OPEN_MAX];
+static fat16_dirnode_t g_dirnodes[FAT16_DIRNODE_MAX];
+static uint32_t g_dirnode_next;
 
 static uint16_t rd16(const uint8_t* p) { return (uint16_t)p[0] | ((uint16_t)p[1] << 8); }
 static uint32_t rd32(const uint8_t* p) { return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24); }
@@ -64,197 +201,1968 @@ static int name11_eq(const uint8_t name[11], const char want[11]) {
     return 1;
 }
 
-static uint32_t cluster_to_lba(uint16_t cluster) {
-    return g_fat.first_data_lba + (uint32_t)(cluster - 2u) * (uint32_t)g_fat.sectors_per_cluster;
+static uint32_t name11_hash(const uint8_t name[11]) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 11; i++) {
+        h ^= name[i];
+        h *= 16777619u;
+    }
+    return h;
 }
 
-static uint16_t fat16_next_cluster(uint16_t cluster) {
-    
-    uint32_t fat_offset = (uint32_t)cluster * 2u;
+static void format_name_83(const uint8_t n[11], char* out, size_t max) {
+    size_t o = 0;
+    for (int i = 0; i < 8 && n[i] != ' ' && o + 1u < max; i++) out[o++] = (char)n[i];
+    if (n[8] != ' ' && o + 1u < max) {
+        out[o++] = '.';
+        for (int j = 8; j < 11 && n[j] != ' ' && o + 1u < max; j++) out[o++] = (char)n[j];
+    }
+    out[o] = '\0';
+}
+
+static uint32_t cluster_to_lba(fat16_volume_t* v, uint32_t cluster) {
+    return v->fat.first_data_lba + (uint32_t)(cluster - 2u) * (uint32_t)v->fat.sectors_per_cluster;
+}
+
+static void fat_cache_reset(fat16_volume_t* v) {
+    kmemset(v->fat_cache_loaded, 0, sizeof(v->fat_cache_loaded));
+    kmemset(v->fat_cache_dirty, 0, sizeof(v->fat_cache_dirty));
+}
+
+static int fat_slot_loaded(fat16_volume_t* v, uint32_t slot) {
+    return (v->fat_cache_loaded[slot >> 3] >> (slot & 7u)) & 1u;
+}
+
+static int fat_dirty(fat16_volume_t* v, uint32_t slot) {
+    return (v->fat_cache_dirty[slot >> 3] >> (slot & 7u)) & 1u;
+}
+
+static int fat_write_copies(fat16_volume_t* v, uint32_t fat_sector, uint32_t count, const uint8_t* in);
+static int disk_flush(fat16_volume_t* v);
+
+static uint8_t* fat_cache_sector(fat16_volume_t* v, uint32_t fat_sector) {
+    if (fat_sector >= v->fat.fat_size_sectors) return 0;
+
+    uint32_t slot = fat_sector % FAT16_FAT_CACHE_SECTORS;
+    uint8_t* sec = &v->fat_cache[slot * 512u];
+    uint8_t bit = (uint8_t)(1u << (slot & 7u));
+
+    if (fat_slot_loaded(v, slot)) {
+        if (v->fat_cache_tag[slot] == fat_sector) {
+            v->stats.fat_hits++;
+            return sec;
+        }
+        if (fat_dirty(v, slot)) {
+            if (disk_flush(v) != 0) return 0;
+            if (fat_write_copies(v, v->fat_cache_tag[slot], 1, sec) != 0) return 0;
+            v->fat_cache_dirty[slot >> 3] &= (uint8_t)~bit;
+        }
+        v->fat_cache_loaded[slot >> 3] &= (uint8_t)~bit;
+    }
+
+    if (ata_read28(v->fat.fat_lba + fat_sector, 1, sec) != 0) return 0;
+    v->fat_cache_tag[slot] = fat_sector;
+    v->fat_cache_loaded[slot >> 3] |= bit;
+    v->stats.fat_sector_reads++;
+    return sec;
+}
+
+static uint32_t fat16_next_cluster(fat16_volume_t* v, uint32_t cluster) {
+    uint32_t width = v->fat.fat32 ? 4u : 2u;
+    uint32_t fat_offset = cluster * width;
+
+    const uint8_t* sec = fat_cache_sector(v, fat_offset / 512u);
+    if (!sec) return FAT_NEXT_ERR;
+
+    if (v->fat.fat32) return rd32(&sec[fat_offset % 512u]) & FAT32_MASK;
+    return rd16(&sec[fat_offset % 512u]);
+}
+
+static int cluster_valid(fat16_volume_t* v, uint32_t cluster) {
+    return cluster >= 2u && cluster < v->fat.cluster_count + 2u;
+}
+
+/* An unreadable FAT32 entry counts as used so allocation never hands it out. */
+static int cluster_used(fat16_volume_t* v, uint32_t cluster) {
+    if (v->fat.fat32) return fat16_next_cluster(v, cluster) != 0;
+    return (v->used_map[cluster >> 5] >> (cluster & 31u)) & 1u;
+}
+
+/* FAT32 keeps one bit per chunk of the FAT: clear only once a scan found it full. */
+static int chunk_may_free(fat16_volume_t* v, uint32_t chunk) {
+    return (v->chunk_free[chunk >> 5] >> (chunk & 31u)) & 1u;
+}
+
+static void chunk_set_free(fat16_volume_t* v, uint32_t chunk, int may_free) {
+    if (may_free) v->chunk_free[chunk >> 5] |= (1u << (chunk & 31u));
+    else v->chunk_free[chunk >> 5] &= ~(1u << (chunk & 31u));
+}
+
+static void cluster_mark(fat16_volume_t* v, uint32_t cluster, int used) {
+    if (v->fat.fat32) {
+        if (!used) chunk_set_free(v, cluster / FAT32_CHUNK_CLUSTERS, 1);
+        return;
+    }
+    if (used) v->used_map[cluster >> 5] |= (1u << (cluster & 31u));
+    else v->used_map[cluster >> 5] &= ~(1u << (cluster & 31u));
+}
+
+static int fat16_set_cluster(fat16_volume_t* v, uint32_t cluster, uint32_t value) {
+    if (!cluster_valid(v, cluster)) return -1;
+
+    int was_used = cluster_used(v, cluster);
+
+    uint32_t width = v->fat.fat32 ? 4u : 2u;
+    uint32_t fat_offset = cluster * width;
     uint32_t fat_sector = fat_offset / 512u;
-    uint32_t ent_offset = fat_offset % 512u;
 
-    uint8_t sec[512];
-    if (ata_read28(g_fat.fat_lba + fat_sector, 1, sec) != 0) return 0xFFFF;
+    uint8_t* sec = fat_cache_sector(v, fat_sector);
+    if (!sec) return -1;
+
+    uint8_t* e = &sec[fat_offset % 512u];
+    e[0] = (uint8_t)(value & 0xFF);
+    e[1] = (uint8_t)((value >> 8) & 0xFF);
+    if (v->fat.fat32) {
+        e[2] = (uint8_t)((value >> 16) & 0xFF);
+        e[3] = (uint8_t)((e[3] & 0xF0) | ((value >> 24) & 0x0F));
+        v->fsinfo_dirty = 1;
+    }
+
+    uint32_t slot = fat_sector % FAT16_FAT_CACHE_SECTORS;
+    v->fat_cache_dirty[slot >> 3] |= (uint8_t)(1u << (slot & 7u));
 
-    return rd16(&sec[ent_offset]);
+    int now_used = (value != 0);
+    if (was_used && !now_used) v->free_count++;
+    if (!was_used && now_used) v->free_count--;
+    cluster_mark(v, cluster, now_used);
+    return 0;
 }
 
-int fat16_mount(uint32_t part_lba_start) {
-    kmemset(&g_fat, 0, sizeof(g_fat));
+static int read_sectors(fat16_volume_t* v, uint32_t lba, uint32_t count, uint8_t* out) {
+    while (count > 0) {
+        uint8_t n = (count > ATA_MAX_SECTORS) ? (uint8_t)ATA_MAX_SECTORS : (uint8_t)count;
+        if (ata_read28(lba, n, out) != 0) return -1;
+        v->stats.data_cmds++;
+        v->stats.data_sectors += n;
+        lba += n;
+        out += (uint32_t)n * 512u;
+        count -= n;
+    }
+    return 0;
+}
 
-    if (!ata_present()) return -1;
+static int write_sectors(fat16_volume_t* v, uint32_t lba, uint32_t count, const uint8_t* in) {
+    if (g_readdir_lba - lba < count) g_readdir_valid = 0;
+    while (count > 0) {
+        uint8_t n = (count > ATA_MAX_SECTORS) ? (uint8_t)ATA_MAX_SECTORS : (uint8_t)count;
+        v->disk_dirty = 1;
+        if (ata_write28(lba, n, in) != 0) return -1;
+        v->stats.write_cmds++;
+        v->stats.write_sectors += n;
+        lba += n;
+        in += (uint32_t)n * 512u;
+        count -= n;
+    }
+    return 0;
+}
 
-    uint8_t bs[512];
-    if (ata_read28(part_lba_start, 1, bs) != 0) return -1;
+/* Ordering point: everything written so far is on media before the next write. */
+static int disk_flush(fat16_volume_t* v) {
+    if (!v->disk_dirty) return 0;
+    if (ata_flush() != 0) return -1;
+    v->disk_dirty = 0;
+    v->stats.disk_flushes++;
+    return 0;
+}
 
-    
-    if (rd16(&bs[510]) != 0xAA55) return -1;
+static int fat_write_copies(fat16_volume_t* v, uint32_t fat_sector, uint32_t count, const uint8_t* in) {
+    for (uint32_t copy = 0; copy < v->fat.num_fats; copy++) {
+        uint32_t lba = v->fat.fat_lba + copy * v->fat.fat_size_sectors + fat_sector;
+        if (write_sectors(v, lba, count, in) != 0) return -1;
+        v->stats.fat_flushes++;
+    }
+    return 0;
+}
 
-    g_fat.part_lba = part_lba_start;
-    g_fat.bytes_per_sector     = rd16(&bs[11]);
-    g_fat.sectors_per_cluster  = bs[13];
-    g_fat.reserved_sectors     = rd16(&bs[14]);
-    g_fat.num_fats             = bs[16];
-    g_fat.root_entry_count     = rd16(&bs[17]);
-    g_fat.fat_size_sectors     = rd16(&bs[22]);
+static int fsinfo_flush(fat16_volume_t* v) {
+    if (!v->fat.fat32 || !v->fsinfo_dirty || v->fat.fsinfo_lba == 0) return 0;
 
-    if (g_fat.bytes_per_sector != 512) return -1;
-    if (g_fat.sectors_per_cluster == 0) return -1;
-    if (g_fat.num_fats == 0) return -1;
-    if (g_fat.fat_size_sectors == 0) return -1;
+    if (read_sectors(v, v->fat.fsinfo_lba, 1, g_dir_sec) != 0) return -1;
+    if (rd32(&g_dir_sec[0]) != 0x41615252u || rd32(&g_dir_sec[484]) != 0x61417272u) return 0;
 
-    g_fat.root_dir_sectors =
-        ((uint32_t)g_fat.root_entry_count * 32u + (uint32_t)g_fat.bytes_per_sector - 1u) /
-        (uint32_t)g_fat.bytes_per_sector;
+    uint32_t vals[2] = { v->free_count, v->next_free };
+    for (uint32_t i = 0; i < 2; i++) {
+        uint8_t* p = &g_dir_sec[488u + i * 4u];
+        p[0] = (uint8_t)(vals[i] & 0xFF);
+        p[1] = (uint8_t)((vals[i] >> 8) & 0xFF);
+        p[2] = (uint8_t)((vals[i] >> 16) & 0xFF);
+        p[3] = (uint8_t)((vals[i] >> 24) & 0xFF);
+    }
+    if (write_sectors(v, v->fat.fsinfo_lba, 1, g_dir_sec) != 0) return -1;
+    v->fsinfo_dirty = 0;
+    return 0;
+}
 
-    uint32_t first_fat = (uint32_t)g_fat.reserved_sectors;
-    uint32_t first_root =
-        first_fat + (uint32_t)g_fat.num_fats * (uint32_t)g_fat.fat_size_sectors;
+static int fat_flush(fat16_volume_t* v) {
+    if (disk_flush(v) != 0) return -1;
 
-    uint32_t first_data =
-        first_root + g_fat.root_dir_sectors;
+    uint32_t s = 0;
+    while (s < FAT16_FAT_CACHE_SECTORS) {
+        if (!fat_dirty(v, s)) {
+            s++;
+            continue;
+        }
+
+        uint32_t e = s + 1u;
+        while (e < FAT16_FAT_CACHE_SECTORS && fat_dirty(v, e) &&
+               v->fat_cache_tag[e] == v->fat_cache_tag[e - 1u] + 1u) e++;
+
+        if (fat_write_copies(v, v->fat_cache_tag[s], e - s, &v->fat_cache[s * 512u]) != 0) return -1;
+
+        for (uint32_t i = s; i < e; i++) {
+            v->fat_cache_dirty[i >> 3] &= (uint8_t)~(1u << (i & 7u));
+        }
+        s = e;
+    }
+    if (fsinfo_flush(v) != 0) return -1;
+    return disk_flush(v);
+}
+
+static int fat_load_all(fat16_volume_t* v) {
+    uint32_t total = v->fat.fat_size_sectors;
+    if (total > FAT16_FAT_CACHE_SECTORS) total = FAT16_FAT_CACHE_SECTORS;
+
+    uint32_t s = 0;
+    while (s < total) {
+        if (fat_slot_loaded(v, s)) {
+            s++;
+            continue;
+        }
 
-    g_fat.fat_lba       = g_fat.part_lba + first_fat;
-    g_fat.root_dir_lba  = g_fat.part_lba + first_root;
-    g_fat.first_data_lba= g_fat.part_lba + first_data;
+        uint32_t e = s;
+        while (e < total && !fat_slot_loaded(v, e)) e++;
 
-    g_fat.mounted = 1;
+        if (read_sectors(v, v->fat.fat_lba + s, e - s, &v->fat_cache[s * 512u]) != 0) return -1;
+        v->stats.fat_sector_reads += e - s;
+        for (uint32_t i = s; i < e; i++) {
+            v->fat_cache_tag[i] = i;
+            v->fat_cache_loaded[i >> 3] |= (uint8_t)(1u << (i & 7u));
+        }
+        s = e;
+    }
     return 0;
 }
 
-static void print_name_83(const uint8_t n[11]) {
-    
-    int i = 0;
-    while (i < 8 && n[i] != ' ') { vga_putc((char)n[i]); i++; }
+/* Pulls a run of FAT sectors into the cache with one read per missing stretch. */
+static int fat_prefetch(fat16_volume_t* v, uint32_t first, uint32_t count) {
+    if (first >= v->fat.fat_size_sectors) return 0;
+    if (count > v->fat.fat_size_sectors - first) count = v->fat.fat_size_sectors - first;
+    if (count > FAT16_FAT_CACHE_SECTORS) count = FAT16_FAT_CACHE_SECTORS;
 
-    
-    int has_ext = 0;
-    for (int j = 0; j < 3; j++) if (n[8+j] != ' ') has_ext = 1;
-    if (has_ext) {
-        vga_putc('.');
-        for (int j = 0; j < 3; j++) {
-            if (n[8+j] == ' ') break;
-            vga_putc((char)n[8+j]);
+    uint32_t s = 0;
+    while (s < count) {
+        uint32_t slot = (first + s) % FAT16_FAT_CACHE_SECTORS;
+        if (fat_slot_loaded(v, slot) && v->fat_cache_tag[slot] == first + s) {
+            s++;
+            continue;
+        }
+
+        uint32_t e = s;
+        while (e < count) {
+            uint32_t i = (first + e) % FAT16_FAT_CACHE_SECTORS;
+            if (e > s && i == 0) break;
+            if (fat_slot_loaded(v, i) && v->fat_cache_tag[i] == first + e) break;
+            if (fat_slot_loaded(v, i) && fat_dirty(v, i)) {
+                if (disk_flush(v) != 0) return -1;
+                if (fat_write_copies(v, v->fat_cache_tag[i], 1, &v->fat_cache[i * 512u]) != 0) return -1;
+                v->fat_cache_dirty[i >> 3] &= (uint8_t)~(1u << (i & 7u));
+            }
+            v->fat_cache_loaded[i >> 3] &= (uint8_t)~(1u << (i & 7u));
+            e++;
         }
+
+        if (read_sectors(v, v->fat.fat_lba + first + s, e - s, &v->fat_cache[slot * 512u]) != 0) return -1;
+        v->stats.fat_sector_reads += e - s;
+        for (uint32_t k = s; k < e; k++) {
+            uint32_t i = (first + k) % FAT16_FAT_CACHE_SECTORS;
+            v->fat_cache_tag[i] = first + k;
+            v->fat_cache_loaded[i >> 3] |= (uint8_t)(1u << (i & 7u));
+        }
+        s = e;
     }
+    return 0;
 }
 
-void fat16_ls_root(void) {
-    if (!g_fat.mounted) {
-        vga_puts("fatls: not mounted (use: mount <0-3>)\n");
-        return;
+/* Mount-time recount reads the FAT a chunk at a time and seeds the chunk summary. */
+static int fat32_recount(fat16_volume_t* v) {
+    uint32_t end = v->fat.cluster_count + 2u;
+    v->free_count = 0;
+
+    for (uint32_t chunk = 0; chunk * FAT32_CHUNK_CLUSTERS < end; chunk++) {
+        uint32_t base = chunk * FAT32_CHUNK_CLUSTERS;
+        uint32_t n = FAT32_CHUNK_SECTORS;
+        if (n > v->fat.fat_size_sectors - chunk * FAT32_CHUNK_SECTORS) n = v->fat.fat_size_sectors - chunk * FAT32_CHUNK_SECTORS;
+        if (n == 0) break;
+        if (read_sectors(v, v->fat.fat_lba + chunk * FAT32_CHUNK_SECTORS, n, g_io_buf) != 0) return -1;
+        v->stats.fat_sector_reads += n;
+
+        uint32_t stop = (end - base < n * 128u) ? end - base : n * 128u;
+        int any = 0;
+        for (uint32_t i = (base == 0) ? 2u : 0u; i < stop; i++) {
+            if ((rd32(&g_io_buf[i * 4u]) & FAT32_MASK) != 0) continue;
+            v->free_count++;
+            any = 1;
+        }
+        chunk_set_free(v, chunk, any);
+    }
+    return 0;
+}
+
+static int fsinfo_load(fat16_volume_t* v) {
+    v->free_count = FAT32_FSINFO_UNKNOWN;
+    v->next_free = FAT32_FSINFO_UNKNOWN;
+    kmemset(v->chunk_free, 0xFF, sizeof(v->chunk_free));
+
+    if (v->fat.fsinfo_lba != 0 && read_sectors(v, v->fat.fsinfo_lba, 1, g_dir_sec) == 0 &&
+        rd32(&g_dir_sec[0]) == 0x41615252u && rd32(&g_dir_sec[484]) == 0x61417272u) {
+        v->free_count = rd32(&g_dir_sec[488]);
+        v->next_free = rd32(&g_dir_sec[492]);
     }
 
-    uint8_t sec[512];
-    uint32_t total = g_fat.root_dir_sectors;
+    if (!cluster_valid(v, v->next_free)) v->next_free = 2;
+    if (v->free_count <= v->fat.cluster_count) return 0;
 
-    for (uint32_t s = 0; s < total; s++) {
-        if (ata_read28(g_fat.root_dir_lba + s, 1, sec) != 0) {
-            vga_puts("fatls: read failed\n");
-            return;
+    if (fat32_recount(v) != 0) return -1;
+    v->fsinfo_dirty = 1;
+    return 0;
+}
+
+static int freemap_build(fat16_volume_t* v) {
+    if (v->fat.fat32) return fsinfo_load(v);
+    if (fat_load_all(v) != 0) return -1;
+
+    kmemset(v->used_map, 0, sizeof(v->used_map));
+    cluster_mark(v, 0, 1);
+    cluster_mark(v, 1, 1);
+    v->free_count = 0;
+
+    for (uint32_t c = 2; c < v->fat.cluster_count + 2u; c++) {
+        if (rd16(&v->fat_cache[c * 2u]) != 0) cluster_mark(v, c, 1);
+        else v->free_count++;
+    }
+
+    v->next_free = 2;
+    return 0;
+}
+
+static uint32_t free_run_at(fat16_volume_t* v, uint32_t start, uint32_t want) {
+    uint32_t end = v->fat.cluster_count + 2u;
+    uint32_t n = 0;
+    while (start + n < end && n < want && !cluster_used(v, start + n)) n++;
+    return n;
+}
+
+static uint32_t find_free_from(fat16_volume_t* v, uint32_t c) {
+    uint32_t end = v->fat.cluster_count + 2u;
+    while (c < end) {
+        if (v->fat.fat32) {
+            uint32_t chunk = c / FAT32_CHUNK_CLUSTERS;
+            uint32_t base = chunk * FAT32_CHUNK_CLUSTERS;
+            uint32_t stop = (end - base < FAT32_CHUNK_CLUSTERS) ? end : base + FAT32_CHUNK_CLUSTERS;
+            if (!chunk_may_free(v, chunk)) {
+                c = stop;
+                continue;
+            }
+            if (fat_prefetch(v, chunk * FAT32_CHUNK_SECTORS, FAT32_CHUNK_SECTORS) != 0) return 0;
+
+            int whole = (c == base || (base == 0 && c == 2u));
+            for (; c < stop; c++) {
+                if (!cluster_used(v, c)) return c;
+            }
+            if (whole) chunk_set_free(v, chunk, 0);
+            continue;
+        }
+        uint32_t word = v->used_map[c >> 5];
+        if ((c & 31u) == 0 && word == 0xFFFFFFFFu) {
+            c += 32u;
+            continue;
+        }
+        if (!((word >> (c & 31u)) & 1u)) return c;
+        c++;
+    }
+    return 0;
+}
+
+static uint32_t find_free_run(fat16_volume_t* v, uint32_t hint, uint32_t want, uint32_t* got) {
+    *got = 0;
+    if (v->free_count == 0 || want == 0) return 0;
+
+    if (cluster_valid(v, hint) && !cluster_used(v, hint)) {
+        *got = free_run_at(v, hint, want);
+        return hint;
+    }
+
+    uint32_t best = 0;
+    uint32_t best_len = 0;
+    uint32_t c = (v->next_free >= 2u) ? v->next_free : 2u;
+    int wrapped = 0;
+
+    for (;;) {
+        c = find_free_from(v, c);
+        if (c == 0) {
+            if (wrapped) break;
+            wrapped = 1;
+            c = 2;
+            continue;
+        }
+        if (wrapped && c >= v->next_free) break;
+
+        uint32_t len = free_run_at(v, c, want);
+        if (len >= want) {
+            *got = len;
+            return c;
         }
+        if (len > best_len) {
+            best = c;
+            best_len = len;
+        }
+        c += len;
+    }
+
+    *got = best_len;
+    return best;
+}
+
+static void free_chain(fat16_volume_t* v, uint32_t cluster) {
+    uint32_t hops = 0;
+    while (cluster_valid(v, cluster) && hops++ <= v->fat.cluster_count) {
+        uint32_t next = fat16_next_cluster(v, cluster);
+        if (next == FAT_NEXT_ERR) return;
+        fat16_set_cluster(v, cluster, 0);
+        if (cluster < v->next_free) v->next_free = cluster;
+        cluster = next;
+    }
+}
+
+static int alloc_chain(fat16_volume_t* v, uint32_t count, uint32_t prev, uint32_t* first_out) {
+    if (count > v->free_count) return -1;
 
-        for (int off = 0; off < 512; off += 32) {
-            const uint8_t* e = &sec[off];
-            uint8_t first = e[0];
+    uint32_t tail = prev;
+    uint32_t hint = cluster_valid(v, prev) ? prev + 1u : 0;
+    uint32_t first = 0;
 
-            if (first == 0x00) return;      
-            if (first == 0xE5) continue;    
-            uint8_t attr = e[11];
-            if (attr == 0x0F) continue;     
-            if (attr & 0x08) continue;      
+    while (count > 0) {
+        uint32_t len = 0;
+        uint32_t c = find_free_run(v, hint, count, &len);
+        if (c == 0 || len == 0) {
+            /* Cut the caller's chain back to its old tail before releasing the new clusters. */
+            if (cluster_valid(v, tail)) fat16_set_cluster(v, tail, v->fat.eoc);
+            if (first) free_chain(v, first);
+            return -1;
+        }
 
-            print_name_83(e);
-            vga_puts("  ");
-            uint32_t size = rd32(&e[28]);
-            kprint_dec(size);
-            vga_puts(" bytes\n");
+        for (uint32_t i = 0; i < len; i++) {
+            uint32_t cl = c + i;
+            if (cluster_valid(v, prev)) fat16_set_cluster(v, prev, cl);
+            fat16_set_cluster(v, cl, v->fat.eoc);
+            if (!first) first = cl;
+            prev = cl;
         }
+
+        count -= len;
+        hint = prev + 1u;
+        v->next_free = hint;
+        v->stats.alloc_runs++;
     }
+
+    if (first_out) *first_out = first;
+    return 0;
 }
 
-static int find_root_entry(const char want11[11], uint8_t out_entry[32]) {
-    uint8_t sec[512];
-    uint32_t total = g_fat.root_dir_sectors;
+static void file_note(fat16_file_t* f, uint32_t index, uint32_t cluster) {
+    if (index != f->index_known || index >= f->index_cap) return;
+    f->index[index] = cluster;
+    f->index_known++;
+}
 
-    for (uint32_t s = 0; s < total; s++) {
-        if (ata_read28(g_fat.root_dir_lba + s, 1, sec) != 0) return -1;
+static void file_open(fat16_volume_t* v, fat16_file_t* f, uint32_t first_cluster, uint32_t size,
+                      uint32_t* index, uint32_t index_cap) {
+    f->vol = v;
+    f->first_cluster = first_cluster;
+    f->size = size;
+    f->cur_cluster = first_cluster;
+    f->cur_index = 0;
+    f->index = index;
+    f->index_cap = index ? index_cap : 0;
+    f->index_known = 0;
+    file_note(f, 0, first_cluster);
+}
 
-        for (int off = 0; off < 512; off += 32) {
-            const uint8_t* e = &sec[off];
-            uint8_t first = e[0];
+static int file_seek_cluster(fat16_file_t* f, uint32_t index) {
+    fat16_volume_t* v = f->vol;
+    if (index == f->cur_index) return 0;
 
-            if (first == 0x00) return -1;      
-            if (first == 0xE5) continue;
-            uint8_t attr = e[11];
-            if (attr == 0x0F) continue;
-            if (attr & 0x08) continue;
+    if (index < f->index_known) {
+        f->cur_cluster = f->index[index];
+        f->cur_index = index;
+        v->stats.index_hits++;
+        return 0;
+    }
 
-            if (name11_eq(e, want11)) {
-                kmemcpy(out_entry, e, 32);
-                return 0;
+    if (f->index_known > 0 && (index < f->cur_index || f->index_known - 1u > f->cur_index)) {
+        f->cur_index = f->index_known - 1u;
+        f->cur_cluster = f->index[f->cur_index];
+    } else if (index < f->cur_index) {
+        f->cur_cluster = f->first_cluster;
+        f->cur_index = 0;
+    }
+
+    while (f->cur_index < index) {
+        uint32_t next = fat16_next_cluster(v, f->cur_cluster);
+        if (!cluster_valid(v, next)) return -1;
+        f->cur_cluster = next;
+        f->cur_index++;
+        file_note(f, f->cur_index, next);
+    }
+    return 0;
+}
+
+static int32_t file_xfer(fat16_file_t* f, uint32_t offset, uint8_t* buf, uint32_t size, int write) {
+    fat16_volume_t* v = f->vol;
+    if (offset >= f->size) return 0;
+    if (size > f->size - offset) size = f->size - offset;
+    if (size == 0) return 0;
+    if (!cluster_valid(v, f->first_cluster)) return -1;
+
+    uint32_t cluster_bytes = (uint32_t)v->fat.sectors_per_cluster * 512u;
+    if (file_seek_cluster(f, offset / cluster_bytes) != 0) return -1;
+
+    uint32_t pos = offset % cluster_bytes;
+    uint32_t done = 0;
+
+    while (done < size) {
+        uint32_t want_end = pos + (size - done);
+        uint32_t run = 1;
+        while (run * cluster_bytes < want_end) {
+            uint32_t next = fat16_next_cluster(v, f->cur_cluster + run - 1u);
+            if (next != f->cur_cluster + run) break;
+            run++;
+        }
+
+        uint32_t run_bytes = run * cluster_bytes;
+        uint32_t end = (want_end < run_bytes) ? want_end : run_bytes;
+        uint32_t lba = cluster_to_lba(v, f->cur_cluster);
+
+        while (pos < end) {
+            uint32_t sec = pos / 512u;
+            uint32_t in_sec = pos % 512u;
+
+            if (in_sec != 0 || end - pos < 512u) {
+                uint32_t n = 512u - in_sec;
+                if (n > end - pos) n = end - pos;
+                if (read_sectors(v, lba + sec, 1, g_edge_sec) != 0) return -1;
+                if (write) {
+                    kmemcpy(&g_edge_sec[in_sec], buf + done, n);
+                    if (write_sectors(v, lba + sec, 1, g_edge_sec) != 0) return -1;
+                } else {
+                    kmemcpy(buf + done, &g_edge_sec[in_sec], n);
+                }
+                pos += n;
+                done += n;
+                continue;
+            }
+
+            uint32_t whole = (end - pos) / 512u;
+            if (write) {
+                if (write_sectors(v, lba + sec, whole, buf + done) != 0) return -1;
+            } else {
+                if (read_sectors(v, lba + sec, whole, buf + done) != 0) return -1;
             }
+            pos += whole * 512u;
+            done += whole * 512u;
+        }
+
+        if (done >= size) break;
+
+        uint32_t last = f->cur_index + run - 1u;
+        for (uint32_t k = 1; k < run; k++) {
+            file_note(f, f->cur_index + k, f->cur_cluster + k);
         }
+        if (run > 1u) {
+            f->cur_cluster = f->cur_cluster + run - 1u;
+            f->cur_index = last;
+        }
+        if (file_seek_cluster(f, last + 1u) != 0) return -1;
+        pos = 0;
     }
-    return -1;
+
+    return (int32_t)done;
 }
 
-void fat16_cat(const char* user_name) {
-    if (!g_fat.mounted) {
-        vga_puts("fatcat: not mounted (use: mount <0-3>)\n");
-        return;
+static int32_t file_read(fat16_file_t* f, uint32_t offset, uint8_t* out, uint32_t size) {
+    return file_xfer(f, offset, out, size, 0);
+}
+
+static void dirent_decode(fat16_volume_t* v, const uint8_t* e, uint32_t lba, uint32_t off, fat16_dirent_t* d) {
+    kmemcpy(d->name, e, 11);
+    d->attr = e[11];
+    d->first_cluster = rd16(&e[26]);
+    if (v->fat.fat32) d->first_cluster |= (uint32_t)rd16(&e[20]) << 16;
+    d->size = rd32(&e[28]);
+    d->ent_lba = lba;
+    d->ent_off = (uint16_t)off;
+    d->hash = name11_hash(e);
+}
+
+static int dirent_skip(const uint8_t* e) {
+    if (e[0] == 0xE5) return 1;
+    if (e[11] == FAT_ATTR_LFN) return 1;
+    if (e[11] & FAT_ATTR_VOLUME) return 1;
+    return 0;
+}
+
+static void dircache_invalidate(fat16_volume_t* v) {
+    v->dir_valid = 0;
+    v->dir_overflow = 0;
+    v->dir_count = 0;
+}
+
+static int scan_sectors(fat16_volume_t* v, uint32_t lba, uint32_t count, dir_visit_fn fn, void* ctx) {
+    for (uint32_t s = 0; s < count; s += FAT16_IO_BUF_SECTORS) {
+        uint32_t n = count - s;
+        if (n > FAT16_IO_BUF_SECTORS) n = FAT16_IO_BUF_SECTORS;
+        if (read_sectors(v, lba + s, n, g_io_buf) != 0) return -1;
+        v->stats.dir_sector_reads += n;
+
+        for (uint32_t off = 0; off < n * 512u; off += 32u) {
+            const uint8_t* e = &g_io_buf[off];
+            if (e[0] == 0x00) return 2;
+            if (dirent_skip(e)) continue;
+
+            fat16_dirent_t d;
+            dirent_decode(v, e, lba + s + off / 512u, off % 512u, &d);
+            if (fn(&d, ctx)) return 1;
+        }
     }
-    if (!user_name || !*user_name) {
-        vga_puts("usage: fatcat <FILE.TXT>\n");
-        return;
+    return 0;
+}
+
+static int dir_scan(fat16_volume_t* v, uint32_t dir_cluster, dir_visit_fn fn, void* ctx) {
+    if (dir_cluster == 0 && !v->fat.fat32) {
+        int r = scan_sectors(v, v->fat.root_dir_lba, v->fat.root_dir_sectors, fn, ctx);
+        return (r == 2) ? 0 : r;
     }
 
-    char want11[11];
-    make_83_name(user_name, want11);
+    uint32_t cl = dir_cluster ? dir_cluster : v->fat.root_cluster;
+    uint32_t hops = 0;
 
-    uint8_t ent[32];
-    if (find_root_entry(want11, ent) != 0) {
-        vga_puts("fatcat: not found: ");
-        vga_puts(user_name);
-        vga_putc('\n');
-        return;
+    while (cluster_valid(v, cl)) {
+        int r = scan_sectors(v, cluster_to_lba(v, cl), v->fat.sectors_per_cluster, fn, ctx);
+        if (r != 0) return (r == 2) ? 0 : r;
+        if (++hops > v->fat.cluster_count) return -1;
+        cl = fat16_next_cluster(v, cl);
+        if (cl == FAT_NEXT_ERR) return -1;
+    }
+    return 0;
+}
+
+static int dircache_visit(const fat16_dirent_t* d, void* ctx) {
+    fat16_volume_t* v = (fat16_volume_t*)ctx;
+    if (v->dir_count >= FAT16_DIRCACHE_MAX) {
+        v->dir_overflow = 1;
+        return 1;
     }
 
-    uint16_t first_cluster = rd16(&ent[26]);
-    uint32_t size = rd32(&ent[28]);
+    v->dir[v->dir_count] = *d;
 
-    if (size == 0) { vga_puts("(empty)\n"); return; }
-    if (first_cluster < 2) { vga_puts("fatcat: bad cluster\n"); return; }
+    uint32_t b = d->hash & (FAT16_DIRCACHE_BUCKETS - 1u);
+    while (v->dir_buckets[b] != 0) b = (b + 1u) & (FAT16_DIRCACHE_BUCKETS - 1u);
+    v->dir_buckets[b] = (uint16_t)(v->dir_count + 1u);
+    v->dir_count++;
+    return 0;
+}
+
+static int dircache_build(fat16_volume_t* v) {
+    if (v->dir_valid) return 0;
+
+    v->dir_count = 0;
+    v->dir_overflow = 0;
+    kmemset(v->dir_buckets, 0, sizeof(v->dir_buckets));
+
+    if (dir_scan(v, 0, dircache_visit, v) < 0) return -1;
+
+    v->dir_valid = 1;
+    return 0;
+}
+
+static const fat16_dirent_t* dircache_lookup(fat16_volume_t* v, const char want11[11]) {
+    if (dircache_build(v) != 0) return 0;
+
+    uint32_t h = name11_hash((const uint8_t*)want11);
+    uint32_t b = h & (FAT16_DIRCACHE_BUCKETS - 1u);
+    while (v->dir_buckets[b] != 0) {
+        const fat16_dirent_t* d = &v->dir[v->dir_buckets[b] - 1u];
+        if (d->hash == h && name11_eq(d->name, want11)) {
+            v->stats.dir_hits++;
+            return d;
+        }
+        b = (b + 1u) & (FAT16_DIRCACHE_BUCKETS - 1u);
+    }
+    return 0;
+}
+
+static void dentry_invalidate(fat16_volume_t* v) {
+    v->dentry_count = 0;
+    v->lru_head = 0;
+    v->lru_tail = 0;
+    kmemset(v->dentry_buckets, 0, sizeof(v->dentry_buckets));
+}
+
+static uint32_t dentry_bucket(uint32_t parent, uint32_t name_hash) {
+    return (name_hash ^ ((uint32_t)parent * 2654435761u)) & (FAT16_DENTRY_BUCKETS - 1u);
+}
+
+static void lru_unlink(fat16_volume_t* v, uint16_t idx) {
+    fat16_dentry_t* de = &v->dentries[idx - 1u];
+    if (de->prev) v->dentries[de->prev - 1u].next = de->next;
+    else v->lru_head = de->next;
+    if (de->next) v->dentries[de->next - 1u].prev = de->prev;
+    else v->lru_tail = de->prev;
+    de->prev = 0;
+    de->next = 0;
+}
+
+static void lru_push_front(fat16_volume_t* v, uint16_t idx) {
+    fat16_dentry_t* de = &v->dentries[idx - 1u];
+    de->prev = 0;
+    de->next = v->lru_head;
+    if (v->lru_head) v->dentries[v->lru_head - 1u].prev = idx;
+    v->lru_head = idx;
+    if (!v->lru_tail) v->lru_tail = idx;
+}
 
-    uint8_t sec[512];
-    uint16_t cl = first_cluster;
-    uint32_t remaining = size;
+static void dentry_unhash(fat16_volume_t* v, uint16_t idx) {
+    fat16_dentry_t* de = &v->dentries[idx - 1u];
+    uint16_t* link = &v->dentry_buckets[dentry_bucket(de->parent, de->ent.hash)];
+    while (*link && *link != idx) link = &v->dentries[*link - 1u].hnext;
+    if (*link) *link = de->hnext;
+    de->hnext = 0;
+}
 
-    while (remaining > 0) {
-        uint32_t lba = cluster_to_lba(cl);
+static int dentry_lookup(fat16_volume_t* v, uint32_t parent, const char want11[11], fat16_dirent_t* out) {
+    uint32_t h = name11_hash((const uint8_t*)want11);
+    uint16_t idx = v->dentry_buckets[dentry_bucket(parent, h)];
 
-        for (uint8_t s = 0; s < g_fat.sectors_per_cluster; s++) {
-            if (ata_read28(lba + s, 1, sec) != 0) {
-                vga_puts("fatcat: read failed\n");
-                return;
+    while (idx) {
+        fat16_dentry_t* de = &v->dentries[idx - 1u];
+        if (de->parent == parent && de->ent.hash == h && name11_eq(de->ent.name, want11)) {
+            if (v->lru_head != idx) {
+                lru_unlink(v, idx);
+                lru_push_front(v, idx);
             }
+            *out = de->ent;
+            v->stats.dentry_hits++;
+            return 0;
+        }
+        idx = de->hnext;
+    }
+    return -1;
+}
+
+static void dentry_insert(fat16_volume_t* v, uint32_t parent, const fat16_dirent_t* d) {
+    uint16_t idx;
+
+    if (v->dentry_count < FAT16_DENTRY_MAX) {
+        idx = (uint16_t)(++v->dentry_count);
+    } else {
+        idx = v->lru_tail;
+        lru_unlink(v, idx);
+        dentry_unhash(v, idx);
+        v->stats.dentry_evictions++;
+    }
+
+    fat16_dentry_t* de = &v->dentries[idx - 1u];
+    de->ent = *d;
+    de->parent = parent;
 
-            uint32_t to_print = (remaining > 512) ? 512 : remaining;
-            for (uint32_t i = 0; i < to_print; i++) vga_putc((char)sec[i]);
-            remaining -= to_print;
+    uint16_t* bucket = &v->dentry_buckets[dentry_bucket(parent, d->hash)];
+    de->hnext = *bucket;
+    *bucket = idx;
+    lru_push_front(v, idx);
+}
 
-            if (remaining == 0) break;
+static int dir_iterate(fat16_volume_t* v, uint32_t dir_cluster, dir_visit_fn fn, void* ctx) {
+    if (dir_cluster == 0) {
+        if (dircache_build(v) != 0) return -1;
+        if (!v->dir_overflow) {
+            for (uint32_t i = 0; i < v->dir_count; i++) {
+                if (fn(&v->dir[i], ctx)) return 1;
+            }
+            return 0;
         }
+    }
+    return dir_scan(v, dir_cluster, fn, ctx);
+}
 
-        uint16_t next = fat16_next_cluster(cl);
-        if (next >= 0xFFF8) break;          
-        if (next == 0xFFF7 || next == 0xFFFF || next < 2) {
-            vga_puts("\nfatcat: bad FAT chain\n");
-            return;
+typedef struct {
+    const char* want11;
+    uint32_t hash;
+    fat16_dirent_t* out;
+} dir_find_ctx_t;
+
+static int dir_find_visit(const fat16_dirent_t* d, void* ctx) {
+    dir_find_ctx_t* c = (dir_find_ctx_t*)ctx;
+    if (d->hash != c->hash || !name11_eq(d->name, c->want11)) return 0;
+    *c->out = *d;
+    return 1;
+}
+
+static int dir_lookup(fat16_volume_t* v, uint32_t dir_cluster, const char want11[11], fat16_dirent_t* out) {
+    if (dir_cluster == 0) {
+        const fat16_dirent_t* d = dircache_lookup(v, want11);
+        if (d) {
+            *out = *d;
+            return 0;
         }
-        cl = next;
+        if (!v->dir_overflow) return -1;
     }
 
-    vga_putc('\n');
-}
\ No newline at end of file
+    if (dentry_lookup(v, dir_cluster, want11, out) == 0) return 0;
+
+    dir_find_ctx_t c = { want11, name11_hash((const uint8_t*)want11), out };
+    if (dir_iterate(v, dir_cluster, dir_find_visit, &c) != 1) return -1;
+
+    dentry_insert(v, dir_cluster, out);
+    return 0;
+}
+
+static void root_dirent(fat16_dirent_t* d) {
+    kmemset(d, 0, sizeof(*d));
+    for (int i = 0; i < 11; i++) d->name[i] = ' ';
+    d->name[0] = '/';
+    d->attr = FAT_ATTR_DIR;
+}
+
+static int resolve_path(fat16_volume_t* v, const char* path, fat16_dirent_t* out) {
+    root_dirent(out);
+
+    while (path && *path && !is_space(*path)) {
+        while (*path == '/') path++;
+        if (!*path || is_space(*path)) break;
+
+        char comp[13];
+        unsigned n = 0;
+        while (*path && *path != '/' && !is_space(*path)) {
+            if (n < sizeof(comp) - 1u) comp[n++] = *path;
+            path++;
+        }
+        comp[n] = '\0';
+
+        if (!(out->attr & FAT_ATTR_DIR)) return -1;
+        if (comp[0] == '.' && comp[1] == '\0') continue;
+
+        char want11[11];
+        if (comp[0] == '.' && comp[1] == '.' && comp[2] == '\0') {
+            if (out->first_cluster == 0) continue;
+            for (int i = 0; i < 11; i++) want11[i] = ' ';
+            want11[0] = '.';
+            want11[1] = '.';
+        } else {
+            make_83_name(comp, want11);
+        }
+
+        uint32_t parent = out->first_cluster;
+        if (dir_lookup(v, parent, want11, out) != 0) return -1;
+        if ((out->attr & FAT_ATTR_DIR) && out->first_cluster == 0) root_dirent(out);
+    }
+    return 0;
+}
+
+static void open_sync(fat16_volume_t* v, const fat16_dirent_t* d, int deleted) {
+    for (uint32_t i = 0; i < FAT16_OPEN_MAX; i++) {
+        fat16_open_t* o = &g_open[i];
+        if (!o->in_use || o->file.vol != v) continue;
+        if (o->ent_lba != d->ent_lba || o->ent_off != d->ent_off) continue;
+
+        uint32_t size = deleted ? 0 : d->size;
+        file_open(v, &o->file, deleted ? 0 : d->first_cluster, size, o->index, FAT16_OPEN_INDEX);
+        o->node.size = size;
+        o->ra_len = 0;
+        o->ent_dirty = 0;
+    }
+}
+
+static int dirent_store(fat16_volume_t* v, const fat16_dirent_t* d, int fresh) {
+    if (disk_flush(v) != 0) return -1;
+    if (read_sectors(v, d->ent_lba, 1, g_dir_sec) != 0) return -1;
+
+    uint8_t* e = &g_dir_sec[d->ent_off];
+    if (fresh) {
+        kmemset(e, 0, 32);
+        kmemcpy(e, d->name, 11);
+        e[11] = d->attr;
+    }
+    e[20] = v->fat.fat32 ? (uint8_t)((d->first_cluster >> 16) & 0xFF) : 0;
+    e[21] = v->fat.fat32 ? (uint8_t)((d->first_cluster >> 24) & 0xFF) : 0;
+    e[26] = (uint8_t)(d->first_cluster & 0xFF);
+    e[27] = (uint8_t)(d->first_cluster >> 8);
+    e[28] = (uint8_t)(d->size & 0xFF);
+    e[29] = (uint8_t)((d->size >> 8) & 0xFF);
+    e[30] = (uint8_t)((d->size >> 16) & 0xFF);
+    e[31] = (uint8_t)((d->size >> 24) & 0xFF);
+
+    if (write_sectors(v, d->ent_lba, 1, g_dir_sec) != 0) return -1;
+    if (disk_flush(v) != 0) return -1;
+
+    dircache_invalidate(v);
+    dentry_invalidate(v);
+    open_sync(v, d, 0);
+    return 0;
+}
+
+static uint32_t dirent_ino(const fat16_dirent_t* d) {
+    return d->ent_lba * 16u + d->ent_off / 32u;
+}
+
+/* Stores the deferred directory entry of an open file, if it has one. */
+static int open_store(fat16_open_t* o) {
+    if (!o->ent_dirty) return 0;
+    fat16_volume_t* v = o->file.vol;
+    if (fat_flush(v) != 0) return -1;
+    if (dirent_store(v, &o->ent, 0) != 0) return -1;
+    o->ent_dirty = 0;
+    return 0;
+}
+
+static int dirent_sync(fat16_volume_t* v, fat16_dirent_t* d) {
+    int r = pcache_sync(v->dev, dirent_ino(d));
+    if (r < 0) return -1;
+    for (uint32_t i = 0; i < FAT16_OPEN_MAX; i++) {
+        fat16_open_t* o = &g_open[i];
+        if (!o->in_use || !o->ent_dirty || o->file.vol != v) continue;
+        if (o->ent_lba != d->ent_lba || o->ent_off != d->ent_off) continue;
+        if (open_store(o) != 0) return -1;
+        r = 1;
+    }
+    if (r == 0) return 0;
+    if (read_sectors(v, d->ent_lba, 1, g_dir_sec) != 0) return -1;
+    dirent_decode(v, &g_dir_sec[d->ent_off], d->ent_lba, d->ent_off, d);
+    return 0;
+}
+
+static int dirent_remove(fat16_volume_t* v, const fat16_dirent_t* d) {
+    if (read_sectors(v, d->ent_lba, 1, g_dir_sec) != 0) return -1;
+    g_dir_sec[d->ent_off] = 0xE5;
+    if (write_sectors(v, d->ent_lba, 1, g_dir_sec) != 0) return -1;
+    if (disk_flush(v) != 0) return -1;
+
+    dircache_invalidate(v);
+    dentry_invalidate(v);
+    open_sync(v, d, 1);
+    return 0;
+}
+
+static int zero_cluster(fat16_volume_t* v, uint32_t cluster) {
+    kmemset(g_io_buf, 0, sizeof(g_io_buf));
+    uint32_t lba = cluster_to_lba(v, cluster);
+    for (uint32_t s = 0; s < v->fat.sectors_per_cluster; s += FAT16_IO_BUF_SECTORS) {
+        uint32_t n = v->fat.sectors_per_cluster - s;
+        if (n > FAT16_IO_BUF_SECTORS) n = FAT16_IO_BUF_SECTORS;
+        if (write_sectors(v, lba + s, n, g_io_buf) != 0) return -1;
+    }
+    return 0;
+}
+
+static int find_free_slot_in(fat16_volume_t* v, uint32_t lba, uint32_t count, fat16_dirent_t* out) {
+    for (uint32_t s = 0; s < count; s += FAT16_IO_BUF_SECTORS) {
+        uint32_t n = count - s;
+        if (n > FAT16_IO_BUF_SECTORS) n = FAT16_IO_BUF_SECTORS;
+        if (read_sectors(v, lba + s, n, g_io_buf) != 0) return -1;
+
+        for (uint32_t off = 0; off < n * 512u; off += 32u) {
+            if (g_io_buf[off] == 0x00 || g_io_buf[off] == 0xE5) {
+                out->ent_lba = lba + s + off / 512u;
+                out->ent_off = (uint16_t)(off % 512u);
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+static int dir_alloc_slot(fat16_volume_t* v, uint32_t dir_cluster, fat16_dirent_t* out) {
+    if (dir_cluster == 0 && !v->fat.fat32) {
+        return (find_free_slot_in(v, v->fat.root_dir_lba, v->fat.root_dir_sectors, out) == 0) ? 0 : -1;
+    }
+
+    uint32_t cl = dir_cluster ? dir_cluster : v->fat.root_cluster;
+    uint32_t last = cl;
+    uint32_t hops = 0;
+    while (cluster_valid(v, cl)) {
+        int r = find_free_slot_in(v, cluster_to_lba(v, cl), v->fat.sectors_per_cluster, out);
+        if (r <= 0) return r;
+        if (++hops > v->fat.cluster_count) return -1;
+        last = cl;
+        cl = fat16_next_cluster(v, cl);
+        if (cl == FAT_NEXT_ERR) return -1;
+    }
+
+    uint32_t fresh = 0;
+    if (alloc_chain(v, 1, last, &fresh) != 0) return -1;
+    if (zero_cluster(v, fresh) != 0) return -1;
+    if (fat_flush(v) != 0) return -1;
+
+    out->ent_lba = cluster_to_lba(v, fresh);
+    out->ent_off = 0;
+    return 0;
+}
+
+static const char* split_parent(const char* path, char* parent, size_t max) {
+    const char* leaf = path;
+    for (const char* p = path; *p && !is_space(*p); p++) {
+        if (*p == '/' && p[1] && !is_space(p[1])) leaf = p + 1;
+    }
+
+    size_t n = (size_t)(leaf - path);
+    if (n >= max) n = max - 1u;
+    kmemcpy(parent, path, n);
+    parent[n] = '\0';
+    return leaf;
+}
+
+static int create_entry(fat16_volume_t* v, const char* path, fat16_dirent_t* out) {
+    char parent_path[128];
+    const char* leaf = split_parent(path, parent_path, sizeof(parent_path));
+    if (!*leaf || *leaf == '/' || *leaf == '.') return -1;
+
+    fat16_dirent_t parent;
+    if (resolve_path(v, parent_path, &parent) != 0) return -1;
+    if (!(parent.attr & FAT_ATTR_DIR)) return -1;
+
+    char want11[11];
+    make_83_name(leaf, want11);
+    if (want11[0] == ' ') return -1;
+
+    fat16_dirent_t existing;
+    if (dir_lookup(v, parent.first_cluster, want11, &existing) == 0) return -1;
+
+    kmemset(out, 0, sizeof(*out));
+    kmemcpy(out->name, want11, 11);
+    out->attr = 0x20;
+    out->hash = name11_hash(out->name);
+
+    if (dir_alloc_slot(v, parent.first_cluster, out) != 0) return -1;
+    return dirent_store(v, out, 1);
+}
+
+static int chain_tail(fat16_volume_t* v, uint32_t first, uint32_t* count, uint32_t* last) {
+    *count = 0;
+    *last = 0;
+    uint32_t cl = first;
+    while (cluster_valid(v, cl)) {
+        if (++*count > v->fat.cluster_count) return -1;
+        *last = cl;
+        cl = fat16_next_cluster(v, cl);
+        if (cl == FAT_NEXT_ERR) return -1;
+    }
+    return 0;
+}
+
+/* Finds the last cluster through the open file's index; walks the chain only if it runs past size. */
+static int file_tail(fat16_file_t* f, uint32_t sized, uint32_t* count, uint32_t* last) {
+    fat16_volume_t* v = f->vol;
+    if (sized > 0 && file_seek_cluster(f, sized - 1u) == 0) {
+        uint32_t next = fat16_next_cluster(v, f->cur_cluster);
+        if (next == FAT_NEXT_ERR) return -1;
+        if (!cluster_valid(v, next)) {
+            *count = sized;
+            *last = f->cur_cluster;
+            return 0;
+        }
+    }
+    return chain_tail(v, f->first_cluster, count, last);
+}
+
+/* Grows the chain and writes the data; the caller flushes the FAT and stores the entry. */
+static int32_t write_data(fat16_volume_t* v, fat16_dirent_t* d, fat16_file_t* f,
+                          uint32_t offset, const uint8_t* data, uint32_t size) {
+    if (offset > d->size) return -1;
+    if (size == 0) return 0;
+
+    uint32_t end = offset + size;
+    if (end < offset) return -1;
+
+    fat16_file_t tmp;
+    if (!f) {
+        file_open(v, &tmp, d->first_cluster, d->size, 0, 0);
+        f = &tmp;
+    } else if (f->first_cluster != d->first_cluster) {
+        file_open(v, f, d->first_cluster, d->size, f->index, f->index_cap);
+    }
+
+    uint32_t cluster_bytes = (uint32_t)v->fat.sectors_per_cluster * 512u;
+    uint32_t need = (end + cluster_bytes - 1u) / cluster_bytes;
+    uint32_t sized = (d->size + cluster_bytes - 1u) / cluster_bytes;
+
+    if (need > sized) {
+        uint32_t have = 0;
+        uint32_t last = 0;
+        if (file_tail(f, sized, &have, &last) != 0) return -1;
+        if (need > have) {
+            uint32_t first_new = 0;
+            if (alloc_chain(v, need - have, last, &first_new) != 0) return -1;
+            if (have == 0) {
+                d->first_cluster = first_new;
+                file_open(v, f, first_new, d->size, f->index, f->index_cap);
+            }
+        }
+    }
+
+    if (d->size > f->size) f->size = d->size;
+    if (end > f->size) f->size = end;
+    int32_t done = file_xfer(f, offset, (uint8_t*)data, size, 1);
+    if (done < 0) return -1;
+
+    if (end > d->size) d->size = end;
+    return done;
+}
+
+static int32_t write_at(fat16_volume_t* v, fat16_dirent_t* d, uint32_t offset, const uint8_t* data, uint32_t size) {
+    uint32_t first = d->first_cluster;
+    int32_t done = write_data(v, d, 0, offset, data, size);
+    /* A failed write still records a freshly allocated chain so it is not leaked. */
+    if (done == 0 || (done < 0 && d->first_cluster == first)) return done;
+    if (fat_flush(v) != 0) return -1;
+    if (dirent_store(v, d, 0) != 0) return -1;
+    return (done < 0) ? -1 : done;
+}
+
+static int truncate_to(fat16_volume_t* v, fat16_dirent_t* d, uint32_t size) {
+    while (d->size < size) {
+        uint32_t n = size - d->size;
+        if (n > sizeof(g_io_buf)) n = sizeof(g_io_buf);
+        kmemset(g_io_buf, 0, n);
+        if (write_at(v, d, d->size, g_io_buf, n) < 0) return -1;
+    }
+    if (d->size == size) return 0;
+
+    uint32_t cluster_bytes = (uint32_t)v->fat.sectors_per_cluster * 512u;
+    uint32_t keep = (size + cluster_bytes - 1u) / cluster_bytes;
+
+    if (keep == 0) {
+        free_chain(v, d->first_cluster);
+        d->first_cluster = 0;
+    } else {
+        fat16_file_t f;
+        file_open(v, &f, d->first_cluster, d->size, 0, 0);
+        if (file_seek_cluster(&f, keep - 1u) != 0) return -1;
+
+        uint32_t next = fat16_next_cluster(v, f.cur_cluster);
+        if (next == FAT_NEXT_ERR) return -1;
+        fat16_set_cluster(v, f.cur_cluster, v->fat.eoc);
+        free_chain(v, next);
+    }
+
+    d->size = size;
+    if (dirent_store(v, d, 0) != 0) return -1;
+    return fat_flush(v);
+}
+
+static int resolve_file(fat16_volume_t* v, const char* path, fat16_dirent_t* d) {
+    if (!v || !v->fat.mounted || !path) return -1;
+    if (resolve_path(v, path, d) != 0) return -1;
+    if (d->attr & FAT_ATTR_DIR) return -1;
+    return dirent_sync(v, d);
+}
+
+static int resolve_update(fat16_volume_t* v, const char* path, fat16_dirent_t* d) {
+    if (resolve_file(v, path, d) != 0) return -1;
+    pcache_invalidate(v->dev, dirent_ino(d));
+    return 0;
+}
+
+int fat16_create(fat16_volume_t* v, const char* path) {
+    if (!v || !v->fat.mounted || !path) return -1;
+    fat16_dirent_t d;
+    return create_entry(v, path, &d);
+}
+
+int32_t fat16_write(fat16_volume_t* v, const char* path, uint32_t offset, const void* data, uint32_t size) {
+    fat16_dirent_t d;
+    if (resolve_update(v, path, &d) != 0) return -1;
+    return write_at(v, &d, offset, (const uint8_t*)data, size);
+}
+
+int32_t fat16_append(fat16_volume_t* v, const char* path, const void* data, uint32_t size) {
+    fat16_dirent_t d;
+    if (resolve_update(v, path, &d) != 0) return -1;
+    return write_at(v, &d, d.size, (const uint8_t*)data, size);
+}
+
+int fat16_truncate(fat16_volume_t* v, const char* path, uint32_t size) {
+    fat16_dirent_t d;
+    if (resolve_update(v, path, &d) != 0) return -1;
+    return truncate_to(v, &d, size);
+}
+
+int fat16_delete(fat16_volume_t* v, const char* path) {
+    fat16_dirent_t d;
+    if (resolve_update(v, path, &d) != 0) return -1;
+
+    if (dirent_remove(v, &d) != 0) return -1;
+    free_chain(v, d.first_cluster);
+    return fat_flush(v);
+}
+
+static size_t fat16_vfs_read(vfs_node_t* node, size_t offset, size_t size, uint8_t* out) {
+    if (!node || !node->impl) return 0;
+    fat16_open_t* o = (fat16_open_t*)node->impl;
+    if (!o->in_use) return 0;
+
+    uint32_t off = (uint32_t)offset;
+    int stream = o->advice == VFS_ADVICE_SEQUENTIAL ||
+                 (o->advice == VFS_ADVICE_NORMAL && off != 0 && off == o->last_end);
+    o->last_end = off + (uint32_t)size;
+
+    if (!stream || size >= FAT16_READAHEAD) {
+        int32_t got = file_read(&o->file, off, out, (uint32_t)size);
+        return (got > 0) ? (size_t)got : 0;
+    }
+
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t pos = off + done;
+        if (pos < o->ra_off || pos >= o->ra_off + o->ra_len) {
+            uint32_t start = pos & ~511u;
+            int32_t got = file_read(&o->file, start, o->ra, FAT16_READAHEAD);
+            if (got <= 0 || start + (uint32_t)got <= pos) break;
+            o->ra_off = start;
+            o->ra_len = (uint32_t)got;
+            o->file.vol->stats.readahead_fills++;
+        }
+        uint32_t n = o->ra_off + o->ra_len - pos;
+        if (n > size - done) n = (uint32_t)size - done;
+        kmemcpy(out + done, &o->ra[pos - o->ra_off], n);
+        done += n;
+    }
+    return done;
+}
+
+static size_t fat16_vfs_write(vfs_node_t* node, size_t offset, size_t size, const uint8_t* data) {
+    if (!node || !node->impl) return 0;
+    fat16_open_t* o = (fat16_open_t*)node->impl;
+    if (!o->in_use) return 0;
+
+    fat16_volume_t* v = o->file.vol;
+    if (!o->ent_dirty) {
+        /* Another open of the same entry may hold a pending update; take it over. */
+        for (uint32_t i = 0; i < FAT16_OPEN_MAX; i++) {
+            fat16_open_t* s = &g_open[i];
+            if (s == o || !s->in_use || !s->ent_dirty || s->file.vol != v) continue;
+            if (s->ent_lba != o->ent_lba || s->ent_off != o->ent_off) continue;
+            o->ent = s->ent;
+            o->ent_dirty = 1;
+            s->ent_dirty = 0;
+        }
+    }
+    if (!o->ent_dirty) {
+        if (read_sectors(v, o->ent_lba, 1, g_dir_sec) != 0) return 0;
+        dirent_decode(v, &g_dir_sec[o->ent_off], o->ent_lba, o->ent_off, &o->ent);
+    }
+
+    uint32_t first = o->ent.first_cluster;
+    int32_t done = write_data(v, &o->ent, &o->file, (uint32_t)offset, data, (uint32_t)size);
+    if (o->ent.first_cluster != first) o->ent_dirty = 1;
+    if (done <= 0) return 0;
+    o->ent_dirty = 1;
+    o->ra_len = 0;
+    if (o->ent.size > node->size) node->size = o->ent.size;
+    return (size_t)done;
+}
+
+static int fat16_vfs_sync(vfs_node_t* node) {
+    if (!node || !node->impl) return -1;
+    fat16_open_t* o = (fat16_open_t*)node->impl;
+    if (!o->in_use) return -1;
+    return open_store(o);
+}
+
+static void fat16_vfs_advise(vfs_node_t* node, vfs_advice_t advice) {
+    if (!node || !node->impl) return;
+    fat16_open_t* o = (fat16_open_t*)node->impl;
+    o->advice = advice;
+    if (advice == VFS_ADVICE_RANDOM) o->ra_len = 0;
+}
+
+static void fat16_vfs_close(vfs_node_t* node) {
+    if (!node || !node->impl) return;
+    fat16_open_t* o = (fat16_open_t*)node->impl;
+    open_store(o);
+    o->in_use = 0;
+}
+
+static vfs_node_t* open_node(fat16_volume_t* v, const fat16_dirent_t* d) {
+    fat16_open_t* o = 0;
+    for (uint32_t i = 0; i < FAT16_OPEN_MAX; i++) {
+        if (!g_open[i].in_use) {
+            o = &g_open[i];
+            break;
+        }
+    }
+    if (!o) return 0;
+
+    o->in_use = 1;
+    o->ent_lba = d->ent_lba;
+    o->ent_off = d->ent_off;
+    o->ent_dirty = 0;
+    o->advice = VFS_ADVICE_NORMAL;
+    o->last_end = 0;
+    o->ra_len = 0;
+    file_open(v, &o->file, d->first_cluster, d->size, o->index, FAT16_OPEN_INDEX);
+
+    vfs_node_t* n = &o->node;
+    kmemset(n, 0, sizeof(*n));
+    format_name_83(d->name, n->name, sizeof(n->name));
+    n->type = VFS_NODE_FILE;
+    n->size = d->size;
+    n->dev = v->dev;
+    n->ino = dirent_ino(d);
+    n->read = fat16_vfs_read;
+    n->write = fat16_vfs_write;
+    n->close = fat16_vfs_close;
+    n->advise = fat16_vfs_advise;
+    n->sync = fat16_vfs_sync;
+    n->impl = o;
+    return n;
+}
+
+static vfs_node_t* fat16_vfs_finddir(vfs_node_t* dir, const char* name);
+
+/* Returns 0 with *lba set, 1 past the end of the directory, -1 on a FAT read error. */
+static int dir_sector_lba(fat16_dirnode_t* dn, uint32_t sector, uint32_t* lba) {
+    fat16_volume_t* v = dn->vol;
+    if (dn->cluster == 0 && !v->fat.fat32) {
+        if (sector >= v->fat.root_dir_sectors) return 1;
+        *lba = v->fat.root_dir_lba + sector;
+        return 0;
+    }
+
+    uint32_t want = sector / v->fat.sectors_per_cluster;
+    uint32_t index = 0;
+    uint32_t cl = dn->cluster ? dn->cluster : v->fat.root_cluster;
+    if (dn->hint_cluster && dn->hint_index <= want) {
+        index = dn->hint_index;
+        cl = dn->hint_cluster;
+    }
+    while (index < want && cluster_valid(v, cl)) {
+        cl = fat16_next_cluster(v, cl);
+        index++;
+    }
+    if (cl == FAT_NEXT_ERR) return -1;
+    if (!cluster_valid(v, cl)) return 1;
+
+    dn->hint_index = index;
+    dn->hint_cluster = cl;
+    *lba = cluster_to_lba(v, cl) + sector % v->fat.sectors_per_cluster;
+    return 0;
+}
+
+static int32_t fat16_vfs_readdir(vfs_node_t* dir, uint32_t* cookie, vfs_dirent_t* out, uint32_t max) {
+    fat16_dirnode_t* dn = (fat16_dirnode_t*)dir->impl;
+    fat16_volume_t* v = dn->vol;
+    if (!v || !v->fat.mounted) return -1;
+    if (*cookie == 0) dn->hint_cluster = 0;
+
+    uint32_t n = 0;
+    while (n < max && *cookie != FAT16_DIR_END) {
+        uint32_t lba;
+        int r = dir_sector_lba(dn, *cookie / 16u, &lba);
+        if (r < 0) return n ? (int32_t)n : -1;
+        if (r > 0) {
+            *cookie = FAT16_DIR_END;
+            break;
+        }
+        if (!g_readdir_valid || g_readdir_lba != lba) {
+            g_readdir_valid = 0;
+            if (read_sectors(v, lba, 1, g_readdir_sec) != 0) return n ? (int32_t)n : -1;
+            g_readdir_lba = lba;
+            g_readdir_valid = 1;
+            v->stats.dir_sector_reads++;
+        }
+
+        for (uint32_t off = (*cookie % 16u) * 32u; off < 512u && n < max; off += 32u) {
+            const uint8_t* e = &g_readdir_sec[off];
+            if (e[0] == 0x00) {
+                *cookie = FAT16_DIR_END;
+                return (int32_t)n;
+            }
+            (*cookie)++;
+            if (dirent_skip(e) || e[0] == '.') continue;
+
+            fat16_dirent_t d;
+            dirent_decode(v, e, lba, off, &d);
+            format_name_83(d.name, out[n].name, sizeof(out[n].name));
+            out[n].type = (d.attr & FAT_ATTR_DIR) ? VFS_NODE_DIR : VFS_NODE_FILE;
+            out[n].size = (d.attr & FAT_ATTR_DIR) ? 0 : d.size;
+            out[n].ino = dirent_ino(&d);
+            n++;
+        }
+    }
+    return (int32_t)n;
+}
+
+static void dirnode_init(fat16_dirnode_t* dn, fat16_volume_t* v, const fat16_dirent_t* d, const char* name) {
+    uint32_t gen = dn->node.gen + 1u;
+    kmemset(&dn->node, 0, sizeof(dn->node));
+    kstrncpy(dn->node.name, name, sizeof(dn->node.name));
+    dn->node.type = VFS_NODE_DIR;
+    dn->node.gen = gen;
+    dn->node.finddir = fat16_vfs_finddir;
+    dn->node.impl = dn;
+    dn->node.readdir = fat16_vfs_readdir;
+    dn->node.dev = v->dev;
+    dn->node.ino = d ? dirent_ino(d) : 0;
+    dn->vol = v;
+    dn->cluster = d ? d->first_cluster : 0;
+    dn->hint_cluster = 0;
+}
+
+static vfs_node_t* dirnode_get(fat16_volume_t* v, const fat16_dirent_t* d, const char* name) {
+    if (d->first_cluster == 0) return &v->root_node.node;
+
+    for (uint32_t i = 0; i < FAT16_DIRNODE_MAX; i++) {
+        fat16_dirnode_t* dn = &g_dirnodes[i];
+        if (dn->vol == v && dn->cluster == d->first_cluster) return &dn->node;
+    }
+
+    fat16_dirnode_t* dn = &g_dirnodes[g_dirnode_next];
+    g_dirnode_next = (g_dirnode_next + 1u) % FAT16_DIRNODE_MAX;
+    dirnode_init(dn, v, d, name);
+    return &dn->node;
+}
+
+static void dirnode_drop_all(fat16_volume_t* v) {
+    v->root_node.node.gen++;
+    for (uint32_t i = 0; i < FAT16_DIRNODE_MAX; i++) {
+        fat16_dirnode_t* dn = &g_dirnodes[i];
+        if (dn->vol != v) continue;
+        dn->vol = 0;
+        dn->node.gen++;
+    }
+}
+
+static vfs_node_t* fat16_vfs_finddir(vfs_node_t* dir, const char* name) {
+    fat16_dirnode_t* dn = (fat16_dirnode_t*)dir->impl;
+    fat16_volume_t* v = dn->vol;
+    if (!v || !v->fat.mounted) return 0;
+
+    char want11[11];
+    if (name[0] == '.' && name[1] == '.' && name[2] == '\0') {
+        if (dn->cluster == 0) return dir;
+        for (int i = 0; i < 11; i++) want11[i] = ' ';
+        want11[0] = '.';
+        want11[1] = '.';
+    } else {
+        make_83_name(name, want11);
+    }
+
+    fat16_dirent_t d;
+    if (dir_lookup(v, dn->cluster, want11, &d) != 0) return 0;
+    if (d.attr & FAT_ATTR_DIR) return dirnode_get(v, &d, name);
+    return open_node(v, &d);
+}
+
+static void open_close_all(fat16_volume_t* v) {
+    for (uint32_t i = 0; i < FAT16_OPEN_MAX; i++) {
+        if (g_open[i].in_use && g_open[i].file.vol == v) g_open[i].in_use = 0;
+    }
+}
+
+static int volume_parse(fat16_volume_t* v, uint32_t part_lba_start) {
+    kmemset(&v->fat, 0, sizeof(v->fat));
+    kmemset(&v->stats, 0, sizeof(v->stats));
+    fat_cache_reset(v);
+    dircache_invalidate(v);
+    dentry_invalidate(v);
+
+    if (!ata_present()) return -1;
+
+    uint8_t bs[512];
+    if (ata_read28(part_lba_start, 1, bs) != 0) return -1;
+
+    
+    if (rd16(&bs[510]) != 0xAA55) return -1;
+
+    v->fat.part_lba = part_lba_start;
+    v->fat.bytes_per_sector     = rd16(&bs[11]);
+    v->fat.sectors_per_cluster  = bs[13];
+    v->fat.reserved_sectors     = rd16(&bs[14]);
+    v->fat.num_fats             = bs[16];
+    v->fat.root_entry_count     = rd16(&bs[17]);
+    v->fat.fat_size_sectors     = rd16(&bs[22]);
+    v->fat.total_sectors        = rd16(&bs[19]) ? rd16(&bs[19]) : rd32(&bs[32]);
+
+    if (v->fat.fat_size_sectors == 0) {
+        v->fat.fat32            = 1;
+        v->fat.fat_size_sectors = rd32(&bs[36]);
+        v->fat.root_cluster     = rd32(&bs[44]);
+        v->fat.fsinfo_lba       = rd16(&bs[48]) ? part_lba_start + rd16(&bs[48]) : 0;
+        if (v->fat.root_entry_count != 0) return -1;
+    }
+    v->fat.eoc = v->fat.fat32 ? FAT32_EOC : FAT16_EOC;
+
+    if (v->fat.bytes_per_sector != 512) return -1;
+    if (v->fat.sectors_per_cluster == 0) return -1;
+    if (v->fat.num_fats == 0) return -1;
+    if (v->fat.fat_size_sectors == 0) return -1;
+
+    v->fat.root_dir_sectors =
+        ((uint32_t)v->fat.root_entry_count * 32u + (uint32_t)v->fat.bytes_per_sector - 1u) /
+        (uint32_t)v->fat.bytes_per_sector;
+
+    uint32_t first_fat = (uint32_t)v->fat.reserved_sectors;
+    uint32_t first_root =
+        first_fat + (uint32_t)v->fat.num_fats * v->fat.fat_size_sectors;
+
+    uint32_t first_data =
+        first_root + v->fat.root_dir_sectors;
+
+    v->fat.fat_lba       = v->fat.part_lba + first_fat;
+    v->fat.root_dir_lba  = v->fat.part_lba + first_root;
+    v->fat.first_data_lba= v->fat.part_lba + first_data;
+
+    if (v->fat.total_sectors <= first_data) return -1;
+
+    uint32_t width = v->fat.fat32 ? 4u : 2u;
+    uint32_t max_clusters = v->fat.fat32 ? FAT32_MAX_CLUSTERS : FAT16_MAX_CLUSTERS;
+    v->fat.cluster_count = (v->fat.total_sectors - first_data) / v->fat.sectors_per_cluster;
+    if (v->fat.cluster_count > max_clusters) v->fat.cluster_count = max_clusters;
+    if ((v->fat.cluster_count + 2u) * width > v->fat.fat_size_sectors * 512u) {
+        v->fat.cluster_count = v->fat.fat_size_sectors * (512u / width) - 2u;
+    }
+    if (v->fat.fat32 && !cluster_valid(v, v->fat.root_cluster)) return -1;
+
+    if (freemap_build(v) != 0) return -1;
+
+    v->fat.mounted = 1;
+    return 0;
+}
+
+fat16_volume_t* fat16_find(const char* name) {
+    if (!name) return 0;
+    for (uint32_t i = 0; i < FAT16_MAX_VOLUMES; i++) {
+        if (g_vols[i].fat.mounted && kstrcmp(g_vols[i].name, name) == 0) return &g_vols[i];
+    }
+    return 0;
+}
+
+fat16_volume_t* fat16_volume_at(uint32_t index) {
+    if (index >= FAT16_MAX_VOLUMES || !g_vols[index].fat.mounted) return 0;
+    return &g_vols[index];
+}
+
+fat16_volume_t* fat16_mount(uint32_t part_lba_start, const char* name) {
+    if (!name || !*name || kstrlen(name) >= FAT16_NAME_MAX) return 0;
+
+    fat16_volume_t* old = fat16_find(name);
+    if (old) fat16_unmount(old);
+
+    fat16_volume_t* v = 0;
+    for (uint32_t i = 0; i < FAT16_MAX_VOLUMES; i++) {
+        if (!g_vols[i].fat.mounted) {
+            v = &g_vols[i];
+            break;
+        }
+    }
+    if (!v) return 0;
+
+    if (volume_parse(v, part_lba_start) != 0) {
+        v->fat.mounted = 0;
+        return 0;
+    }
+
+    kstrncpy(v->name, name, sizeof(v->name));
+    kstrncpy(v->mount_path, FAT16_VFS_PREFIX, sizeof(v->mount_path));
+    kstrncpy(v->mount_path + kstrlen(FAT16_VFS_PREFIX), name, FAT16_NAME_MAX);
+    v->dev = vfs_alloc_dev();
+    dirnode_init(&v->root_node, v, 0, name);
+    vfs_mount(v->mount_path, &v->root_node.node);
+    return v;
+}
+
+int fat16_unmount(fat16_volume_t* v) {
+    if (!v || !v->fat.mounted) return -1;
+
+    int r = 0;
+    if (pcache_sync(v->dev, PCACHE_ALL) < 0) r = -1;
+    pcache_invalidate(v->dev, PCACHE_ALL);
+    for (uint32_t i = 0; i < FAT16_OPEN_MAX; i++) {
+        if (g_open[i].in_use && g_open[i].file.vol == v && open_store(&g_open[i]) != 0) r = -1;
+    }
+    if (fat_flush(v) != 0) r = -1;
+    open_close_all(v);
+    dirnode_drop_all(v);
+    vfs_unmount(v->mount_path);
+    v->fat.mounted = 0;
+    return r;
+}
+
+const char* fat16_name(const fat16_volume_t* v) {
+    return (v && v->fat.mounted) ? v->name : "none";
+}
+
+const char* fat16_mount_path(const fat16_volume_t* v) {
+    return (v && v->fat.mounted) ? v->mount_path : 0;
+}
+
+const char* fat16_type_name(const fat16_volume_t* v) {
+    if (!v || !v->fat.mounted) return "none";
+    return v->fat.fat32 ? "FAT32" : "FAT16";
+}
+
+uint32_t fat16_part_lba(const fat16_volume_t* v) {
+    return (v && v->fat.mounted) ? v->fat.part_lba : 0;
+}
+
+void fat16_cat(fat16_volume_t* v, const char* path) {
+    if (!v || !v->fat.mounted) {
+        vga_puts("fatcat: not mounted (use: mount <0-3> [name])\n");
+        return;
+    }
+    if (!path || !*path) {
+        vga_puts("usage: fatcat <path>\n");
+        return;
+    }
+
+    fat16_dirent_t d;
+    if (resolve_path(v, path, &d) != 0) {
+        vga_puts("fatcat: not found: ");
+        vga_puts(path);
+        vga_putc('\n');
+        return;
+    }
+    if (d.attr & FAT_ATTR_DIR) {
+        vga_puts("fatcat: is a directory: ");
+        vga_puts(path);
+        vga_putc('\n');
+        return;
+    }
+    if (dirent_sync(v, &d) != 0) return;
+
+    uint32_t first_cluster = d.first_cluster;
+    uint32_t size = d.size;
+
+    if (size == 0) { vga_puts("(empty)\n"); return; }
+    if (!cluster_valid(v, first_cluster)) { vga_puts("fatcat: bad cluster\n"); return; }
+
+    fat16_file_t f;
+    file_open(v, &f, first_cluster, size, 0, 0);
+
+    uint32_t off = 0;
+    while (off < size) {
+        int32_t got = file_read(&f, off, g_io_buf, sizeof(g_io_buf));
+        if (got <= 0) {
+            vga_puts("\nfatcat: read failed or bad FAT chain\n");
+            return;
+        }
+        for (int32_t i = 0; i < got; i++) vga_putc((char)g_io_buf[i]);
+        off += (uint32_t)got;
+    }
+
+    vga_putc('\n');
+}
+
+int32_t fat16_read(fat16_volume_t* v, const char* path, uint32_t offset, void* out, uint32_t size) {
+    if (!v || !v->fat.mounted || !path || !out) return -1;
+
+    fat16_dirent_t d;
+    if (resolve_file(v, path, &d) != 0) return -1;
+
+    fat16_file_t f;
+    file_open(v, &f, d.first_cluster, d.size, 0, 0);
+    return file_read(&f, offset, (uint8_t*)out, size);
+}
+
+typedef struct {
+    uint32_t files;
+    uint32_t fragmented;
+    uint32_t moved;
+    uint32_t breaks_removed;
+    uint32_t no_space;
+} defrag_totals_t;
+
+typedef struct {
+    uint32_t skip;
+    uint32_t seen;
+    uint32_t count;
+    fat16_dirent_t ents[FAT16_DEFRAG_BATCH];
+} defrag_batch_t;
+
+typedef struct {
+    uint32_t cluster;
+    char path[FAT16_DEFRAG_PATH];
+} defrag_dir_t;
+
+static defrag_batch_t g_defrag_batch;
+static defrag_dir_t g_defrag_stack[FAT16_DEFRAG_DEPTH];
+
+static int chain_breaks(fat16_volume_t* v, uint32_t first, uint32_t* count, uint32_t* breaks) {
+    *count = 0;
+    *breaks = 0;
+    uint32_t cl = first;
+    while (cluster_valid(v, cl)) {
+        if (++*count > v->fat.cluster_count) return -1;
+        uint32_t next = fat16_next_cluster(v, cl);
+        if (next == FAT_NEXT_ERR) return -1;
+        if (cluster_valid(v, next) && next != cl + 1u) (*breaks)++;
+        cl = next;
+    }
+    return 0;
+}
+
+static int relocate_chain(fat16_volume_t* v, fat16_dirent_t* d, uint32_t count) {
+    uint32_t got = 0;
+    uint32_t dst = find_free_run(v, 0, count, &got);
+    if (dst == 0 || got < count) return 1;
+
+    uint32_t cluster_bytes = (uint32_t)v->fat.sectors_per_cluster * 512u;
+    uint32_t total = count * cluster_bytes;
+    uint32_t dst_lba = cluster_to_lba(v, dst);
+
+    fat16_file_t f;
+    file_open(v, &f, d->first_cluster, total, 0, 0);
+    for (uint32_t off = 0; off < total; off += sizeof(g_io_buf)) {
+        uint32_t n = total - off;
+        if (n > sizeof(g_io_buf)) n = sizeof(g_io_buf);
+        if (file_read(&f, off, g_io_buf, n) != (int32_t)n) return -1;
+        if (write_sectors(v, dst_lba + off / 512u, n / 512u, g_io_buf) != 0) return -1;
+    }
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t next = (i + 1u < count) ? dst + i + 1u : v->fat.eoc;
+        if (fat16_set_cluster(v, dst + i, next) != 0) return -1;
+    }
+    v->next_free = dst + count;
+    v->stats.alloc_runs++;
+    if (fat_flush(v) != 0) return -1;
+
+    uint32_t old = d->first_cluster;
+    d->first_cluster = dst;
+    if (dirent_store(v, d, 0) != 0) return -1;
+
+    free_chain(v, old);
+    return fat_flush(v);
+}
+
+static void defrag_entry(fat16_volume_t* v, fat16_dirent_t* d, const char* dir_path,
+                         int apply, defrag_totals_t* t) {
+    uint32_t count = 0;
+    uint32_t breaks = 0;
+    t->files++;
+
+    /* Pull in pending page-cache data and deferred entry updates before trusting d. */
+    if (dirent_sync(v, d) != 0) {
+        char name[13];
+        format_name_83(d->name, name, sizeof(name));
+        vga_puts(dir_path);
+        vga_puts(name);
+        vga_puts(": sync failed, skipped\n");
+        return;
+    }
+    if (chain_breaks(v, d->first_cluster, &count, &breaks) != 0 || breaks == 0) return;
+    t->fragmented++;
+
+    char name[13];
+    format_name_83(d->name, name, sizeof(name));
+    vga_puts(dir_path);
+    vga_puts(name);
+    vga_puts(": ");
+    kprint_dec(count);
+    vga_puts(" clusters, ");
+    kprint_dec(breaks + 1u);
+    vga_puts(" fragments");
+
+    if (!apply) {
+        vga_putc('\n');
+        return;
+    }
+
+    int r = relocate_chain(v, d, count);
+    if (r == 0) {
+        t->moved++;
+        t->breaks_removed += breaks;
+        vga_puts(" -> contiguous\n");
+    } else if (r > 0) {
+        t->no_space++;
+        vga_puts(" (no contiguous free run)\n");
+    } else {
+        vga_puts(" (I/O error)\n");
+    }
+}
+
+static int defrag_collect(const fat16_dirent_t* d, void* ctx) {
+    defrag_batch_t* b = (defrag_batch_t*)ctx;
+    if (b->seen++ < b->skip) return 0;
+    b->ents[b->count++] = *d;
+    return b->count >= FAT16_DEFRAG_BATCH;
+}
+
+static void defrag_tree(fat16_volume_t* v, int apply, defrag_totals_t* t) {
+    uint32_t depth = 1;
+    g_defrag_stack[0].cluster = 0;
+    kstrncpy(g_defrag_stack[0].path, "/", sizeof(g_defrag_stack[0].path));
+
+    while (depth > 0) {
+        defrag_dir_t dir = g_defrag_stack[--depth];
+        defrag_batch_t* b = &g_defrag_batch;
+        b->skip = 0;
+
+        for (;;) {
+            b->seen = 0;
+            b->count = 0;
+            if (dir_iterate(v, dir.cluster, defrag_collect, b) < 0) break;
+
+            for (uint32_t i = 0; i < b->count; i++) {
+                fat16_dirent_t* d = &b->ents[i];
+                if (d->name[0] == '.') continue;
+
+                if (!(d->attr & FAT_ATTR_DIR)) {
+                    defrag_entry(v, d, dir.path, apply, t);
+                    continue;
+                }
+                if (depth >= FAT16_DEFRAG_DEPTH || !cluster_valid(v, d->first_cluster)) continue;
+
+                defrag_dir_t* sub = &g_defrag_stack[depth++];
+                sub->cluster = d->first_cluster;
+                char name[13];
+                format_name_83(d->name, name, sizeof(name));
+                uint32_t n = (uint32_t)kstrlen(dir.path);
+                kstrncpy(sub->path, dir.path, sizeof(sub->path));
+                kstrncpy(sub->path + n, name, sizeof(sub->path) - n);
+                n += (uint32_t)kstrlen(name);
+                if (n + 2u <= sizeof(sub->path)) {
+                    sub->path[n] = '/';
+                    sub->path[n + 1u] = '\0';
+                }
+            }
+
+            if (b->count < FAT16_DEFRAG_BATCH) break;
+            b->skip = b->seen;
+        }
+    }
+}
+
+void fat16_defrag(fat16_volume_t* v, const char* path, int apply) {
+    if (!v || !v->fat.mounted) {
+        vga_puts("fatdefrag: not mounted (use: mount <0-3> [name])\n");
+        return;
+    }
+
+    defrag_totals_t t;
+    kmemset(&t, 0, sizeof(t));
+
+    if (path && *path) {
+        fat16_dirent_t d;
+        if (resolve_file(v, path, &d) != 0) {
+            vga_puts("fatdefrag: not a file: ");
+            vga_puts(path);
+            vga_putc('\n');
+            return;
+        }
+        defrag_entry(v, &d, "", apply, &t);
+    } else {
+        defrag_tree(v, apply, &t);
+    }
+
+    kprint_dec(t.files);
+    vga_puts(" files, ");
+    kprint_dec(t.fragmented);
+    vga_puts(" fragmented");
+    if (apply) {
+        vga_puts(", ");
+        kprint_dec(t.moved);
+        vga_puts(" relocated, ");
+        kprint_dec(t.breaks_removed);
+        vga_puts(" run breaks removed");
+        if (t.no_space) {
+            vga_puts(", ");
+            kprint_dec(t.no_space);
+            vga_puts(" skipped (no space)");
+        }
+    }
+    vga_putc('\n');
+}
+
+void fat16_get_stats(const fat16_volume_t* v, fat16_stats_t* out) {
+    if (v && out) *out = v->stats;
+}
+
+void fat16_print_stats(fat16_volume_t* v) {
+    if (!v || !v->fat.mounted) {
+        vga_puts("fatstat: not mounted (use: mount <0-3> [name])\n");
+        return;
+    }
+
+    uint32_t resident = 0;
+    for (uint32_t i = 0; i < FAT16_FAT_CACHE_SECTORS; i++) {
+        if (fat_slot_loaded(v, i)) resident++;
+    }
+
+    vga_puts(v->name);
+    vga_puts(" (");
+    vga_puts(fat16_type_name(v));
+    vga_puts(") FAT cache: ");
+    kprint_dec(resident);
+    vga_putc('/');
+    kprint_dec(v->fat.fat_size_sectors);
+    vga_puts(" sectors resident\n");
+    vga_puts("  FAT sector reads: ");
+    kprint_dec(v->stats.fat_sector_reads);
+    vga_putc('\n');
+    vga_puts("  FAT reads avoided: ");
+    kprint_dec(v->stats.fat_hits);
+    vga_putc('\n');
+    vga_puts("  dir cache: ");
+    kprint_dec(v->dir_valid ? v->dir_count : 0);
+    vga_puts(" entries, ");
+    kprint_dec(v->stats.dir_hits);
+    vga_puts(" hits\n");
+    vga_puts("  dentry cache: ");
+    kprint_dec(v->dentry_count);
+    vga_putc('/');
+    kprint_dec(FAT16_DENTRY_MAX);
+    vga_puts(" used, ");
+    kprint_dec(v->stats.dentry_hits);
+    vga_puts(" hits, ");
+    kprint_dec(v->stats.dentry_evictions);
+    vga_puts(" evictions\n");
+    vga_puts("  dir sector reads: ");
+    kprint_dec(v->stats.dir_sector_reads);
+    vga_putc('\n');
+    vga_puts("  cluster index hits: ");
+    kprint_dec(v->stats.index_hits);
+    vga_puts(", readahead fills: ");
+    kprint_dec(v->stats.readahead_fills);
+    vga_putc('\n');
+    vga_puts("  free clusters: ");
+    kprint_dec(v->free_count);
+    vga_putc('/');
+    kprint_dec(v->fat.cluster_count);
+    vga_puts(", alloc runs: ");
+    kprint_dec(v->stats.alloc_runs);
+    vga_putc('\n');
+    vga_puts("  data reads: ");
+    kprint_dec(v->stats.data_cmds);
+    vga_puts(" commands, ");
+    kprint_dec(v->stats.data_sectors);
+    vga_puts(" sectors\n");
+    vga_puts("  writes: ");
+    kprint_dec(v->stats.write_cmds);
+    vga_puts(" commands, ");
+    kprint_dec(v->stats.write_sectors);
+    vga_puts(" sectors, ");
+    kprint_dec(v->stats.fat_flushes);
+    vga_puts(" FAT flushes, ");
+    kprint_dec(v->stats.disk_flushes);
+    vga_puts(" cache flushes\n");
+}
@@ -1,6 +1,45 @@
 #pragma once
 #include <stdint.h>
 
-int fat16_mount(uint32_t part_lba_start);
-void fat16_ls_root(void);
-void fat16_cat(const char* user_name); 
\ No newline at end of file
+#define FAT16_VFS_PREFIX "/mnt/"
+#define FAT16_NAME_MAX   8
+#define FAT16_MAX_VOLUMES 4u
+
+typedef struct fat16_volume fat16_volume_t;
+
+typedef struct {
+    uint32_t fat_sector_reads;
+    uint32_t fat_hits;
+    uint32_t data_cmds;
+    uint32_t data_sectors;
+    uint32_t dir_hits;
+    uint32_t dentry_hits;
+    uint32_t dentry_evictions;
+    uint32_t dir_sector_reads;
+    uint32_t index_hits;
+    uint32_t readahead_fills;
+    uint32_t write_cmds;
+    uint32_t write_sectors;
+    uint32_t fat_flushes;
+    uint32_t disk_flushes;
+    uint32_t alloc_runs;
+} fat16_stats_t;
+
+fat16_volume_t* fat16_mount(uint32_t part_lba_start, const char* name);
+int fat16_unmount(fat16_volume_t* vol);
+fat16_volume_t* fat16_find(const char* name);
+fat16_volume_t* fat16_volume_at(uint32_t index);
+const char* fat16_name(const fat16_volume_t* vol);
+const char* fat16_type_name(const fat16_volume_t* vol);
+uint32_t fat16_part_lba(const fat16_volume_t* vol);
+const char* fat16_mount_path(const fat16_volume_t* vol);
+void fat16_cat(fat16_volume_t* vol, const char* path);
+int32_t fat16_read(fat16_volume_t* vol, const char* path, uint32_t offset, void* out, uint32_t size);
+int fat16_create(fat16_volume_t* vol, const char* path);
+int32_t fat16_write(fat16_volume_t* vol, const char* path, uint32_t offset, const void* data, uint32_t size);
+int32_t fat16_append(fat16_volume_t* vol, const char* path, const void* data, uint32_t size);
+int fat16_truncate(fat16_volume_t* vol, const char* path, uint32_t size);
+int fat16_delete(fat16_volume_t* vol, const char* path);
+void fat16_defrag(fat16_volume_t* vol, const char* path, int apply);
+void fat16_get_stats(const fat16_volume_t* vol, fat16_stats_t* out);
+void fat16_print_stats(fat16_volume_t* vol);
@@ -3,8 +3,20 @@
 #include "../vga.h"
 #include "../debug/print.h"
 #include "../lib/string.h"
+#include "../lib/lz4.h"
+#include "../lib/crc32c.h"
 
-#define INITRD_MAGIC 0x44495244u
+#define INITRD_MAGIC        0x44495244u
+#define INITRD_MAGIC_LZ4    0x5A524944u
+#define INITRD_MAGIC_V2     0x32524944u
+#define INITRD_LZ4_BLOCK    65536u
+#define INITRD_CACHE_BYTES  (1024u * 1024u)
+#define INITRD_INFLATED_MAX 64u
+#define INITRD_POOL         32u
+#define INITRD_VERIFY_MAX   4096u
+
+#define INITRD2_F_CRC32C 0x1u
+#define INITRD2_E_LZ4    0x1u
 
 typedef struct initrd_header {
     uint32_t magic;
@@ -17,47 +29,416 @@ typedef struct initrd_file {
     uint32_t length;
 } __attribute__((packed)) initrd_file_t;
 
+typedef struct initrd2_header {
+    uint32_t magic;
+    uint32_t nfiles;
+    uint32_t nbuckets;
+    uint32_t flags;
+    uint32_t buckets_off;
+    uint32_t entries_off;
+    uint32_t names_off;
+    uint32_t names_size;
+} __attribute__((packed)) initrd2_header_t;
+
+typedef struct initrd2_entry {
+    uint32_t hash;
+    uint32_t next;
+    uint32_t name_off;
+    uint16_t name_len;
+    uint16_t flags;
+    uint32_t offset;
+    uint32_t length;
+    uint32_t stored;
+    uint32_t crc;
+} __attribute__((packed)) initrd2_entry_t;
+
+typedef struct initrd_lz4_file {
+    uint32_t block_size;
+    uint32_t nblocks;
+} __attribute__((packed)) initrd_lz4_file_t;
+
+typedef struct initrd_span {
+    uint32_t index;
+    uint32_t offset;
+    uint32_t length;
+    uint32_t stored;
+    uint32_t crc;
+    int lz4;
+} initrd_span_t;
+
+typedef struct initrd_node {
+    vfs_node_t node;
+    initrd_span_t span;
+    uint32_t refs;
+} initrd_node_t;
+
 typedef struct initrd_ctx {
     const uint8_t* base;
     uint32_t size;
-    const initrd_header_t* hdr;
+    uint32_t nfiles;
     const initrd_file_t* files;
+    const initrd2_header_t* v2;
+    const uint32_t* buckets;
+    const initrd2_entry_t* entries;
+    const char* names;
+    int lz4;
 } initrd_ctx_t;
 
+typedef struct initrd_inflated {
+    uint32_t offset;
+    uint8_t* data;
+} initrd_inflated_t;
+
 static initrd_ctx_t g_ctx;
-static vfs_node_t g_nodes[VFS_MAX_NODES];
+static initrd_node_t g_nodes[VFS_MAX_NODES];
+static initrd_node_t g_pool[INITRD_POOL];
+static uint32_t g_pool_next;
+static vfs_node_t g_root;
+
+static uint8_t g_cache[INITRD_CACHE_BYTES];
+static uint32_t g_cache_used;
+static initrd_inflated_t g_inflated[INITRD_INFLATED_MAX];
+
+static uint32_t g_verified[INITRD_VERIFY_MAX / 32u];
+
+static uint8_t g_block[INITRD_LZ4_BLOCK];
+static uint32_t g_block_file;
+static uint32_t g_block_index;
+static uint32_t g_block_len;
+
+static const uint32_t* lz4_ends(const initrd_span_t* s) {
+    return (const uint32_t*)(g_ctx.base + s->offset + sizeof(initrd_lz4_file_t));
+}
+
+static int32_t lz4_block(const initrd_span_t* s, uint32_t b, uint8_t* dst) {
+    const initrd_lz4_file_t* z = (const initrd_lz4_file_t*)(g_ctx.base + s->offset);
+    const uint32_t* ends = lz4_ends(s);
+    const uint8_t* data = (const uint8_t*)&ends[z->nblocks];
+
+    uint32_t start = b ? ends[b - 1u] : 0;
+    uint32_t packed = ends[b] - start;
+    uint32_t raw = s->length - b * z->block_size;
+    if (raw > z->block_size) raw = z->block_size;
+
+    if (packed == raw) {
+        kmemcpy(dst, data + start, raw);
+        return (int32_t)raw;
+    }
+    int32_t got = lz4_decompress_block(data + start, packed, dst, raw);
+    return (got == (int32_t)raw) ? got : -1;
+}
+
+static const uint8_t* inflated_get(const initrd_span_t* s) {
+    for (uint32_t i = 0; i < INITRD_INFLATED_MAX; i++) {
+        if (g_inflated[i].data && g_inflated[i].offset == s->offset) return g_inflated[i].data;
+    }
+    return 0;
+}
+
+static const uint8_t* inflate_file(const initrd_span_t* s) {
+    const uint8_t* hit = inflated_get(s);
+    if (hit) return hit;
+    if (s->length > INITRD_CACHE_BYTES - g_cache_used) return 0;
+
+    initrd_inflated_t* slot = 0;
+    for (uint32_t i = 0; i < INITRD_INFLATED_MAX && !slot; i++) {
+        if (!g_inflated[i].data) slot = &g_inflated[i];
+    }
+    if (!slot) return 0;
+
+    const initrd_lz4_file_t* z = (const initrd_lz4_file_t*)(g_ctx.base + s->offset);
+    uint8_t* dst = &g_cache[g_cache_used];
+    for (uint32_t b = 0; b < z->nblocks; b++) {
+        if (lz4_block(s, b, dst + b * z->block_size) < 0) return 0;
+    }
+    g_cache_used += (s->length + 15u) & ~15u;
+    slot->offset = s->offset;
+    slot->data = dst;
+    return dst;
+}
+
+static size_t read_blocks(const initrd_span_t* s, uint32_t offset, uint32_t size, uint8_t* out) {
+    const initrd_lz4_file_t* z = (const initrd_lz4_file_t*)(g_ctx.base + s->offset);
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t pos = offset + done;
+        uint32_t b = pos / z->block_size;
+        if (g_block_file != s->offset || g_block_index != b) {
+            int32_t got = lz4_block(s, b, g_block);
+            if (got < 0) {
+                g_block_file = 0;
+                break;
+            }
+            g_block_file = s->offset;
+            g_block_index = b;
+            g_block_len = (uint32_t)got;
+        }
+        uint32_t in = pos - b * z->block_size;
+        uint32_t n = g_block_len - in;
+        if (n > size - done) n = size - done;
+        kmemcpy(out + done, &g_block[in], n);
+        done += n;
+    }
+    return done;
+}
 
 static size_t initrd_read(vfs_node_t* node, size_t offset, size_t size, uint8_t* out) {
     if (!node || !node->impl) return 0;
-    const initrd_file_t* f = (const initrd_file_t*)node->impl;
+    const initrd_span_t* s = &((const initrd_node_t*)node->impl)->span;
 
-    if (offset >= f->length) return 0;
-    uint32_t remaining = f->length - (uint32_t)offset;
+    if (offset >= s->length) return 0;
+    uint32_t remaining = s->length - (uint32_t)offset;
     if (size > remaining) size = remaining;
 
-    const uint8_t* src = g_ctx.base + f->offset + (uint32_t)offset;
-    kmemcpy(out, src, size);
+    const uint8_t* src = g_ctx.base + s->offset;
+    if (s->lz4) {
+        src = inflated_get(s);
+        if (!src && offset == 0) src = inflate_file(s);
+        if (!src) return read_blocks(s, (uint32_t)offset, (uint32_t)size, out);
+    }
+    kmemcpy(out, src + offset, size);
     return size;
 }
 
+static int initrd_map(vfs_node_t* node, const uint8_t** ptr, uint32_t* len) {
+    if (!node || !node->impl) return -1;
+    const initrd_span_t* s = &((const initrd_node_t*)node->impl)->span;
+
+    const uint8_t* src = g_ctx.base + s->offset;
+    if (s->lz4 && !(src = inflate_file(s))) return -1;
+    *ptr = src;
+    *len = s->length;
+    return 0;
+}
+
+static void initrd_close(vfs_node_t* node) {
+    initrd_node_t* n = (initrd_node_t*)node->impl;
+    if (n->refs > 0) n->refs--;
+}
+
+static int span_valid(const initrd_span_t* s) {
+    if (s->offset > g_ctx.size || s->stored > g_ctx.size - s->offset) return 0;
+    if (!s->lz4) return s->stored == s->length;
+
+    if (s->stored < sizeof(initrd_lz4_file_t)) return 0;
+    const initrd_lz4_file_t* z = (const initrd_lz4_file_t*)(g_ctx.base + s->offset);
+    if (z->block_size == 0 || z->block_size > INITRD_LZ4_BLOCK) return 0;
+    if (z->nblocks != (s->length + z->block_size - 1u) / z->block_size) return 0;
+
+    uint32_t avail = s->stored - (uint32_t)sizeof(initrd_lz4_file_t);
+    if (z->nblocks > avail / 4u) return 0;
+    avail -= z->nblocks * 4u;
+
+    const uint32_t* ends = lz4_ends(s);
+    uint32_t prev = 0;
+    for (uint32_t b = 0; b < z->nblocks; b++) {
+        if (ends[b] < prev || ends[b] > avail) return 0;
+        prev = ends[b];
+    }
+    return 1;
+}
+
+static void span_v1(uint32_t i, initrd_span_t* s) {
+    const initrd_file_t* f = &g_ctx.files[i];
+    s->index = i;
+    s->offset = f->offset;
+    s->length = f->length;
+    s->stored = g_ctx.lz4 ? g_ctx.size - f->offset : f->length;
+    s->crc = 0;
+    s->lz4 = g_ctx.lz4;
+}
+
+static void span_v2(uint32_t i, initrd_span_t* s) {
+    const initrd2_entry_t* e = &g_ctx.entries[i];
+    s->index = i;
+    s->offset = e->offset;
+    s->length = e->length;
+    s->stored = e->stored;
+    s->crc = e->crc;
+    s->lz4 = (e->flags & INITRD2_E_LZ4) != 0;
+}
+
+static void node_init(initrd_node_t* n, const char* name, uint32_t name_len) {
+    uint32_t gen = n->node.gen + 1u;
+    kmemset(&n->node, 0, sizeof(n->node));
+    if (name_len >= sizeof(n->node.name)) name_len = sizeof(n->node.name) - 1u;
+    kmemcpy(n->node.name, name, name_len);
+    n->node.type = VFS_NODE_FILE;
+    n->node.size = n->span.length;
+    n->node.gen = gen;
+    n->node.ino = n->span.index;
+    n->node.read = initrd_read;
+    n->node.map = initrd_map;
+    n->node.impl = n;
+}
+
+static int name_eq(const char* a, const char* b, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        if (a[i] != b[i]) return 0;
+    }
+    return 1;
+}
+
+/* Checksums an entry the first time it is needed; entries past the bitmap are checked every time. */
+static int entry_verify(uint32_t index) {
+    if (!(g_ctx.v2->flags & INITRD2_F_CRC32C)) return 1;
+    if (index < INITRD_VERIFY_MAX && ((g_verified[index >> 5] >> (index & 31u)) & 1u)) return 1;
+
+    const initrd2_entry_t* e = &g_ctx.entries[index];
+    if (e->offset > g_ctx.size || e->stored > g_ctx.size - e->offset) return 0;
+    if (crc32c(0, g_ctx.base + e->offset, e->stored) != e->crc) {
+        vga_puts("[fs] initrd checksum mismatch: entry ");
+        kprint_dec(index);
+        vga_putc('\n');
+        return 0;
+    }
+    if (index < INITRD_VERIFY_MAX) g_verified[index >> 5] |= 1u << (index & 31u);
+    return 1;
+}
+
+static vfs_node_t* v2_node(uint32_t index) {
+    initrd_node_t* victim = 0;
+    for (uint32_t k = 0; k < INITRD_POOL; k++) {
+        initrd_node_t* n = &g_pool[(g_pool_next + k) % INITRD_POOL];
+        if (n->node.impl && n->span.index == index) {
+            n->refs++;
+            return &n->node;
+        }
+        if (!victim && n->refs == 0) victim = n;
+    }
+    if (!victim) return 0;
+
+    span_v2(index, &victim->span);
+    if (!span_valid(&victim->span) || !entry_verify(index)) {
+        victim->node.impl = 0;
+        return 0;
+    }
+
+    const initrd2_entry_t* e = &g_ctx.entries[index];
+    node_init(victim, g_ctx.names + e->name_off, e->name_len);
+    victim->node.close = initrd_close;
+    victim->refs = 1;
+    g_pool_next = (uint32_t)(victim - g_pool + 1) % INITRD_POOL;
+    return &victim->node;
+}
+
+static vfs_node_t* v2_finddir(vfs_node_t* dir, const char* name) {
+    (void)dir;
+    const initrd2_header_t* h = g_ctx.v2;
+    uint32_t len = (uint32_t)kstrlen(name);
+    uint32_t hash = vfs_name_hash(name);
+
+    uint32_t link = g_ctx.buckets[hash & (h->nbuckets - 1u)];
+    for (uint32_t steps = 0; link != 0 && link <= h->nfiles && steps < h->nfiles; steps++) {
+        const initrd2_entry_t* e = &g_ctx.entries[link - 1u];
+        if (e->hash == hash && e->name_len == len &&
+            e->name_off <= h->names_size && len <= h->names_size - e->name_off &&
+            name_eq(g_ctx.names + e->name_off, name, len)) {
+            return v2_node(link - 1u);
+        }
+        link = e->next;
+    }
+    return 0;
+}
+
+static int32_t v2_readdir(vfs_node_t* dir, uint32_t* cookie, vfs_dirent_t* out, uint32_t max) {
+    (void)dir;
+    const initrd2_header_t* h = g_ctx.v2;
+    uint32_t n = 0;
+    while (n < max && *cookie < h->nfiles) {
+        uint32_t i = (*cookie)++;
+        const initrd2_entry_t* e = &g_ctx.entries[i];
+        uint32_t len = e->name_len;
+        if (e->name_off > h->names_size || len > h->names_size - e->name_off) continue;
+        if (len >= sizeof(out[n].name)) len = sizeof(out[n].name) - 1u;
+        kmemcpy(out[n].name, g_ctx.names + e->name_off, len);
+        out[n].name[len] = '\0';
+        out[n].type = VFS_NODE_FILE;
+        out[n].size = e->length;
+        out[n].ino = i;
+        n++;
+    }
+    return (int32_t)n;
+}
+
+static int table_fits(uint32_t off, uint32_t count, uint32_t elem, uint32_t size) {
+    return off <= size && count <= (size - off) / elem;
+}
+
+static int initrd_validate_v2(const uint8_t* base, uint32_t size) {
+    if (size < sizeof(initrd2_header_t)) return 0;
+    const initrd2_header_t* h = (const initrd2_header_t*)base;
+    if (h->nbuckets == 0 || (h->nbuckets & (h->nbuckets - 1u)) != 0) return 0;
+    if (!table_fits(h->buckets_off, h->nbuckets, 4u, size)) return 0;
+    if (!table_fits(h->entries_off, h->nfiles, sizeof(initrd2_entry_t), size)) return 0;
+    if (!table_fits(h->names_off, h->names_size, 1u, size)) return 0;
+    return 1;
+}
+
 static int initrd_validate(const uint8_t* base, uint32_t size) {
     if (!base || size < sizeof(initrd_header_t)) return 0;
     const initrd_header_t* h = (const initrd_header_t*)base;
-    if (h->magic != INITRD_MAGIC) return 0;
+    if (h->magic == INITRD_MAGIC_V2) return initrd_validate_v2(base, size);
+    if (h->magic != INITRD_MAGIC && h->magic != INITRD_MAGIC_LZ4) return 0;
 
     uint32_t dir_size = sizeof(initrd_header_t) + h->nfiles * sizeof(initrd_file_t);
     if (dir_size > size) return 0;
 
     const initrd_file_t* files = (const initrd_file_t*)(base + sizeof(initrd_header_t));
     for (uint32_t i = 0; i < h->nfiles; i++) {
-        uint32_t end = files[i].offset + files[i].length;
         if (files[i].offset < dir_size) return 0;
-        if (end > size) return 0;
         if (files[i].name[31] != '\0') return 0;
+
+        initrd_span_t s;
+        span_v1(i, &s);
+        if (!span_valid(&s)) return 0;
     }
     return 1;
 }
 
+static void mount_v1(void) {
+    uint32_t n = g_ctx.nfiles;
+    if (n > VFS_MAX_NODES) n = VFS_MAX_NODES;
+
+    for (uint32_t i = 0; i < n; i++) {
+        initrd_node_t* node = &g_nodes[i];
+        span_v1(i, &node->span);
+        node_init(node, g_ctx.files[i].name, (uint32_t)kstrlen(g_ctx.files[i].name));
+        vfs_register(&node->node);
+    }
+    vfs_mount(INITRD_MOUNT_PATH, vfs_registry_root());
+}
+
+static void mount_v2(void) {
+    const initrd2_header_t* h = g_ctx.v2;
+    g_ctx.buckets = (const uint32_t*)(g_ctx.base + h->buckets_off);
+    g_ctx.entries = (const initrd2_entry_t*)(g_ctx.base + h->entries_off);
+    g_ctx.names = (const char*)(g_ctx.base + h->names_off);
+
+    for (uint32_t i = 0; i < INITRD_POOL; i++) {
+        g_pool[i].node.impl = 0;
+        g_pool[i].refs = 0;
+    }
+    kmemset(g_verified, 0, sizeof(g_verified));
+
+    kmemset(&g_root, 0, sizeof(g_root));
+    kstrncpy(g_root.name, "initrd", sizeof(g_root.name));
+    g_root.type = VFS_NODE_DIR;
+    g_root.finddir = v2_finddir;
+    g_root.readdir = v2_readdir;
+    vfs_mount(INITRD_MOUNT_PATH, &g_root);
+    vfs_set_cwd(&g_root);
+}
+
+int initrd_verify(void) {
+    if (!g_ctx.v2 || !g_ctx.entries || !(g_ctx.v2->flags & INITRD2_F_CRC32C)) return -1;
+    int bad = 0;
+    for (uint32_t i = 0; i < g_ctx.v2->nfiles; i++) {
+        if (!entry_verify(i)) bad++;
+    }
+    return bad;
+}
+
 int initrd_mount_from_multiboot(const multiboot_info_t* mb) {
     if (!mb) return -1;
 
@@ -72,37 +453,34 @@ int initrd_mount_from_multiboot(const multiboot_info_t* mb) {
     const uint8_t* base = (const uint8_t*)(uintptr_t)m0->mod_start;
     uint32_t size = m0->mod_end - m0->mod_start;
 
+    kmemset(&g_ctx, 0, sizeof(g_ctx));
+    g_ctx.base = base;
+    g_ctx.size = size;
+    if (size >= sizeof(initrd_header_t)) {
+        const initrd_header_t* hdr = (const initrd_header_t*)base;
+        g_ctx.nfiles = hdr->nfiles;
+        g_ctx.files = (const initrd_file_t*)(base + sizeof(initrd_header_t));
+        g_ctx.lz4 = hdr->magic == INITRD_MAGIC_LZ4;
+        if (hdr->magic == INITRD_MAGIC_V2) g_ctx.v2 = (const initrd2_header_t*)base;
+    }
+
     if (!initrd_validate(base, size)) {
         vga_puts("[fs] initrd invalid\n");
         return -1;
     }
 
-    const initrd_header_t* hdr = (const initrd_header_t*)base;
-    const initrd_file_t* files = (const initrd_file_t*)(base + sizeof(initrd_header_t));
-
-    g_ctx.base = base;
-    g_ctx.size = size;
-    g_ctx.hdr = hdr;
-    g_ctx.files = files;
+    g_cache_used = 0;
+    g_block_file = 0;
+    kmemset(g_inflated, 0, sizeof(g_inflated));
 
     vfs_init();
-
-    uint32_t n = hdr->nfiles;
-    if (n > VFS_MAX_NODES) n = VFS_MAX_NODES;
-
-    for (uint32_t i = 0; i < n; i++) {
-        vfs_node_t* node = &g_nodes[i];
-        kmemset(node, 0, sizeof(*node));
-        kstrncpy(node->name, files[i].name, sizeof(node->name));
-        node->type = VFS_NODE_FILE;
-        node->size = files[i].length;
-        node->read = initrd_read;
-        node->impl = (void*)&files[i];
-        vfs_register(node);
-    }
+    if (g_ctx.v2) mount_v2();
+    else mount_v1();
 
     vga_puts("[fs] initrd mounted: files=");
-    kprint_dec(hdr->nfiles);
+    kprint_dec(g_ctx.nfiles);
+    if (g_ctx.v2) vga_puts((g_ctx.v2->flags & INITRD2_F_CRC32C) ? " (v2, crc32c on open)" : " (v2)");
+    else if (g_ctx.lz4) vga_puts(" (lz4)");
     vga_putc('\n');
     return 0;
 }
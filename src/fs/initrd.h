@@ -1,4 +1,9 @@
 #pragma once
 #include "../boot/multiboot.h"
 
+#define INITRD_MOUNT_PATH "/initrd"
+
 int initrd_mount_from_multiboot(const multiboot_info_t* mb);
+
+/* Checksums every v2 entry; returns the number that failed, or -1 without checksums. */
+int initrd_verify(void);
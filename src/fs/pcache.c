@@ -0,0 +1,313 @@
+#include "pcache.h"
+#include "../memory/frame.h"
+#include "../lib/string.h"
+
+typedef struct {
+    uint32_t dev;
+    uint32_t ino;
+    uint32_t index;
+    uint32_t len;
+    uint8_t* data;
+    vfs_node_t* owner;
+    uint16_t hnext;
+    uint8_t ref;
+    uint8_t dirty;
+} pcache_page_t;
+
+static pcache_page_t g_pages[PCACHE_MAX_PAGES];
+static uint16_t g_buckets[PCACHE_BUCKETS];
+static uint16_t g_free_head;
+static uint32_t g_hand;
+static pcache_stats_t g_stats;
+static uint8_t g_run[PCACHE_RUN_PAGES * PCACHE_PAGE];
+
+static uint32_t page_hash(uint32_t dev, uint32_t ino, uint32_t index) {
+    uint32_t h = dev * 0x9E3779B1u;
+    h ^= ino * 0x85EBCA77u;
+    h ^= index * 0xC2B2AE3Du;
+    return (h ^ (h >> 15)) & (PCACHE_BUCKETS - 1u);
+}
+
+static pcache_page_t* page_lookup(uint32_t dev, uint32_t ino, uint32_t index) {
+    uint16_t i = g_buckets[page_hash(dev, ino, index)];
+    while (i != 0) {
+        pcache_page_t* p = &g_pages[i - 1u];
+        if (p->dev == dev && p->ino == ino && p->index == index) return p;
+        i = p->hnext;
+    }
+    return 0;
+}
+
+static void page_unlink(pcache_page_t* p) {
+    uint16_t id = (uint16_t)(p - g_pages + 1);
+    uint16_t* link = &g_buckets[page_hash(p->dev, p->ino, p->index)];
+    while (*link != 0 && *link != id) link = &g_pages[*link - 1u].hnext;
+    if (*link == id) *link = p->hnext;
+}
+
+static void page_drop(pcache_page_t* p) {
+    page_unlink(p);
+    frame_free(p->data);
+    if (p->dirty) g_stats.dirty--;
+    p->data = 0;
+    p->owner = 0;
+    p->dirty = 0;
+    p->hnext = g_free_head;
+    g_free_head = (uint16_t)(p - g_pages + 1);
+    g_stats.pages--;
+}
+
+/* Writes a run of consecutive dirty pages with one call; pages stay dirty on failure. */
+static int run_writeback(pcache_page_t** run, uint32_t count) {
+    vfs_node_t* n = run[0]->owner;
+    if (!n || !n->write) return -1;
+
+    const uint8_t* src = run[0]->data;
+    uint32_t len = run[0]->len;
+    if (count > 1u) {
+        len = 0;
+        for (uint32_t i = 0; i < count; i++) {
+            kmemcpy(&g_run[len], run[i]->data, run[i]->len);
+            len += run[i]->len;
+        }
+        src = g_run;
+    }
+
+    uint32_t off = run[0]->index * PCACHE_PAGE;
+    if (n->write(n, off, len, src) != len) return -1;
+    for (uint32_t i = 0; i < count; i++) {
+        run[i]->dirty = 0;
+        run[i]->owner = 0;
+        g_stats.dirty--;
+    }
+    g_stats.writebacks++;
+    return 0;
+}
+
+static int page_after(const pcache_page_t* p, uint32_t dev, uint32_t ino, uint32_t index) {
+    if (p->dev != dev) return p->dev > dev;
+    if (p->ino != ino) return p->ino > ino;
+    return p->index > index;
+}
+
+/* Walks dirty pages in (dev, ino, index) order; each owner's sync hook runs once after its pages. */
+static int sync_pages(uint32_t dev, uint32_t ino) {
+    int r = 0;
+    int written = 0;
+    int started = 0;
+    uint32_t cur_dev = 0, cur_ino = 0, cur_index = 0;
+    vfs_node_t* pending = 0;
+
+    for (;;) {
+        pcache_page_t* next = 0;
+        for (uint32_t i = 0; i < PCACHE_MAX_PAGES; i++) {
+            pcache_page_t* p = &g_pages[i];
+            if (!p->data || !p->dirty) continue;
+            if (dev && p->dev != dev) continue;
+            if (ino != PCACHE_ALL && p->ino != ino) continue;
+            if (started && !page_after(p, cur_dev, cur_ino, cur_index)) continue;
+            if (!next || page_after(next, p->dev, p->ino, p->index)) next = p;
+        }
+        if (!next) break;
+
+        vfs_node_t* owner = next->owner;
+        if (pending && pending != owner) {
+            if (pending->sync && pending->sync(pending) != 0) r = -1;
+            pending = 0;
+        }
+
+        pcache_page_t* run[PCACHE_RUN_PAGES];
+        uint32_t count = 0;
+        run[count++] = next;
+        while (count < PCACHE_RUN_PAGES && run[count - 1u]->len == PCACHE_PAGE) {
+            pcache_page_t* p = page_lookup(next->dev, next->ino, next->index + count);
+            if (!p || !p->dirty || p->owner != owner) break;
+            run[count++] = p;
+        }
+
+        started = 1;
+        cur_dev = next->dev;
+        cur_ino = next->ino;
+        cur_index = run[count - 1u]->index;
+
+        if (run_writeback(run, count) != 0) {
+            r = -1;
+            continue;
+        }
+        written += (int)count;
+        pending = owner;
+    }
+
+    if (pending && pending->sync && pending->sync(pending) != 0) r = -1;
+    return r ? r : written;
+}
+
+static uint32_t pcache_reclaim(uint32_t want) {
+    uint32_t freed = 0;
+    for (uint32_t scanned = 0; scanned < 2u * PCACHE_MAX_PAGES && freed < want; scanned++) {
+        pcache_page_t* p = &g_pages[g_hand];
+        g_hand = (g_hand + 1u) % PCACHE_MAX_PAGES;
+        if (!p->data) continue;
+        if (p->ref) {
+            p->ref = 0;
+            continue;
+        }
+        if (p->dirty) sync_pages(p->dev, p->ino);
+        if (p->dirty) continue;
+        page_drop(p);
+        g_stats.evictions++;
+        freed++;
+    }
+    return freed;
+}
+
+void pcache_init(void) {
+    kmemset(g_pages, 0, sizeof(g_pages));
+    kmemset(g_buckets, 0, sizeof(g_buckets));
+    for (uint32_t i = 0; i < PCACHE_MAX_PAGES; i++) {
+        g_pages[i].hnext = (i + 1u < PCACHE_MAX_PAGES) ? (uint16_t)(i + 2u) : 0;
+    }
+    g_free_head = 1;
+    g_hand = 0;
+    kmemset(&g_stats, 0, sizeof(g_stats));
+    frame_register_reclaim(pcache_reclaim);
+}
+
+static pcache_page_t* page_new(vfs_node_t* node, uint32_t index) {
+    if (g_free_head == 0 && pcache_reclaim(1) == 0) return 0;
+
+    uint8_t* data = (uint8_t*)frame_alloc();
+    if (!data) return 0;
+    if (g_free_head == 0) {
+        frame_free(data);
+        return 0;
+    }
+
+    pcache_page_t* p = &g_pages[g_free_head - 1u];
+    g_free_head = p->hnext;
+
+    p->dev = node->dev;
+    p->ino = node->ino;
+    p->index = index;
+    p->len = 0;
+    p->data = data;
+    p->owner = 0;
+    p->ref = 1;
+    p->dirty = 0;
+
+    uint32_t b = page_hash(p->dev, p->ino, index);
+    p->hnext = g_buckets[b];
+    g_buckets[b] = (uint16_t)(p - g_pages + 1);
+    g_stats.pages++;
+    return p;
+}
+
+static pcache_page_t* page_get(vfs_node_t* node, uint32_t index, int fill) {
+    pcache_page_t* p = page_lookup(node->dev, node->ino, index);
+    if (p) {
+        p->ref = 1;
+        g_stats.hits++;
+        return p;
+    }
+
+    g_stats.misses++;
+    p = page_new(node, index);
+    if (!p || !fill) return p;
+
+    uint32_t off = index * PCACHE_PAGE;
+    uint32_t want = (node->size - off < PCACHE_PAGE) ? node->size - off : PCACHE_PAGE;
+    p->len = (uint32_t)node->read(node, off, want, p->data);
+    if (p->len < want) {
+        /* Never cache a failed or short fill; the caller falls back to the bypass path. */
+        page_drop(p);
+        return 0;
+    }
+    return p;
+}
+
+size_t pcache_read(vfs_node_t* node, uint32_t offset, uint32_t size, uint8_t* out) {
+    if (offset >= node->size) return 0;
+    if (size > node->size - offset) size = node->size - offset;
+
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t pos = offset + done;
+        uint32_t in = pos % PCACHE_PAGE;
+        uint32_t n = PCACHE_PAGE - in;
+        if (n > size - done) n = size - done;
+
+        pcache_page_t* p = page_get(node, pos / PCACHE_PAGE, 1);
+        if (!p) {
+            g_stats.bypass++;
+            size_t got = node->read(node, pos, n, out + done);
+            done += (uint32_t)got;
+            if (got < n) break;
+            continue;
+        }
+
+        if (in >= p->len) break;
+        if (n > p->len - in) n = p->len - in;
+        kmemcpy(out + done, &p->data[in], n);
+        done += n;
+    }
+    return done;
+}
+
+size_t pcache_write(vfs_node_t* node, uint32_t offset, uint32_t size, const uint8_t* data) {
+    if (offset > node->size) return 0;
+
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t pos = offset + done;
+        uint32_t in = pos % PCACHE_PAGE;
+        uint32_t n = PCACHE_PAGE - in;
+        if (n > size - done) n = size - done;
+
+        uint32_t page_off = pos - in;
+        int fill = page_off < node->size;
+        pcache_page_t* p = page_get(node, pos / PCACHE_PAGE, fill);
+        if (!p) {
+            g_stats.bypass++;
+            if (sync_pages(node->dev, node->ino) < 0) return done;
+            size_t got = node->write(node, pos, size - done, data + done);
+            if (node->sync) node->sync(node);
+            pcache_invalidate(node->dev, node->ino);
+            return done + (uint32_t)got;
+        }
+        if (in > p->len) break;
+
+        kmemcpy(&p->data[in], data + done, n);
+        if (in + n > p->len) p->len = in + n;
+        if (!p->dirty) g_stats.dirty++;
+        p->dirty = 1;
+        p->owner = node;
+        done += n;
+        if (pos + n > node->size) node->size = pos + n;
+    }
+    return done;
+}
+
+int pcache_sync(uint32_t dev, uint32_t ino) {
+    return sync_pages(dev, ino);
+}
+
+int pcache_release(vfs_node_t* node) {
+    if (!node || !node->dev) return 0;
+    for (uint32_t i = 0; i < PCACHE_MAX_PAGES; i++) {
+        if (g_pages[i].data && g_pages[i].owner == node) return sync_pages(node->dev, node->ino);
+    }
+    return 0;
+}
+
+void pcache_invalidate(uint32_t dev, uint32_t ino) {
+    for (uint32_t i = 0; i < PCACHE_MAX_PAGES; i++) {
+        pcache_page_t* p = &g_pages[i];
+        if (!p->data || p->dev != dev) continue;
+        if (ino != PCACHE_ALL && p->ino != ino) continue;
+        page_drop(p);
+    }
+}
+
+void pcache_get_stats(pcache_stats_t* out) {
+    if (out) *out = g_stats;
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+#include "vfs.h"
+
+#define PCACHE_PAGE      4096u
+#define PCACHE_MAX_PAGES 4096u
+#define PCACHE_BUCKETS   8192u
+#define PCACHE_RUN_PAGES 16u
+#define PCACHE_ALL       0xFFFFFFFFu
+
+typedef struct {
+    uint32_t pages;
+    uint32_t dirty;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t writebacks;
+    uint32_t bypass;
+} pcache_stats_t;
+
+void   pcache_init(void);
+size_t pcache_read(vfs_node_t* node, uint32_t offset, uint32_t size, uint8_t* out);
+size_t pcache_write(vfs_node_t* node, uint32_t offset, uint32_t size, const uint8_t* data);
+int    pcache_sync(uint32_t dev, uint32_t ino);
+int    pcache_release(vfs_node_t* node);
+void   pcache_invalidate(uint32_t dev, uint32_t ino);
+void   pcache_get_stats(pcache_stats_t* out);
@@ -0,0 +1,255 @@
+#include "tmpfs.h"
+#include "vfs.h"
+#include "../memory/frame.h"
+#include "../lib/string.h"
+
+#define TMPFS_DIRECT     4u
+#define TMPFS_INDIRECT   (FRAME_SIZE / sizeof(uint8_t*))
+#define TMPFS_FILE_PAGES (TMPFS_DIRECT + TMPFS_INDIRECT)
+
+typedef struct {
+    vfs_node_t node;
+    uint8_t* direct[TMPFS_DIRECT];
+    uint8_t** indirect;
+    uint32_t children;
+    uint16_t parent;
+    uint16_t hnext; /* name-hash chain while used, free list otherwise */
+    uint16_t refs;
+    uint8_t used;
+    uint8_t unlinked;
+} tmpfs_inode_t;
+
+static tmpfs_inode_t g_inodes[TMPFS_MAX_NODES];
+static uint16_t g_buckets[TMPFS_BUCKETS];
+static uint16_t g_free_head;
+static uint32_t g_files;
+static uint32_t g_pages;
+
+static vfs_node_t* tmpfs_finddir(vfs_node_t* dir, const char* name);
+static vfs_node_t* tmpfs_create(vfs_node_t* dir, const char* name, vfs_node_type_t type);
+static int tmpfs_unlink(vfs_node_t* dir, const char* name);
+static int32_t tmpfs_readdir(vfs_node_t* dir, uint32_t* cookie, vfs_dirent_t* out, uint32_t max);
+
+static uint16_t inode_id(const tmpfs_inode_t* t) {
+    return (uint16_t)(t - g_inodes);
+}
+
+static uint32_t bucket_of(uint16_t parent, uint32_t hash) {
+    return (hash ^ (parent * 0x9E3779B1u)) & (TMPFS_BUCKETS - 1u);
+}
+
+static tmpfs_inode_t* index_lookup(uint16_t parent, const char* name) {
+    uint32_t hash = vfs_name_hash(name);
+    uint16_t i = g_buckets[bucket_of(parent, hash)];
+    while (i != 0) {
+        tmpfs_inode_t* t = &g_inodes[i - 1u];
+        if (t->parent == parent && t->node.hash == hash && kstrcmp(t->node.name, name) == 0) return t;
+        i = t->hnext;
+    }
+    return 0;
+}
+
+static void index_insert(tmpfs_inode_t* t) {
+    uint32_t b = bucket_of(t->parent, t->node.hash);
+    t->hnext = g_buckets[b];
+    g_buckets[b] = (uint16_t)(inode_id(t) + 1u);
+}
+
+static void index_remove(tmpfs_inode_t* t) {
+    uint16_t id = (uint16_t)(inode_id(t) + 1u);
+    uint16_t* link = &g_buckets[bucket_of(t->parent, t->node.hash)];
+    while (*link != 0 && *link != id) link = &g_inodes[*link - 1u].hnext;
+    if (*link == id) *link = t->hnext;
+}
+
+static uint8_t** page_slot(tmpfs_inode_t* t, uint32_t index, int alloc) {
+    if (index < TMPFS_DIRECT) return &t->direct[index];
+    if (!t->indirect) {
+        if (!alloc) return 0;
+        t->indirect = (uint8_t**)frame_alloc();
+        if (!t->indirect) return 0;
+        kmemset(t->indirect, 0, FRAME_SIZE);
+    }
+    return &t->indirect[index - TMPFS_DIRECT];
+}
+
+static void inode_free(tmpfs_inode_t* t) {
+    for (uint32_t i = 0; i < TMPFS_FILE_PAGES; i++) {
+        uint8_t** slot = page_slot(t, i, 0);
+        if (!slot) break;
+        if (!*slot) continue;
+        frame_free(*slot);
+        g_pages--;
+    }
+    if (t->indirect) frame_free(t->indirect);
+    t->indirect = 0;
+    if (t->node.type == VFS_NODE_FILE) g_files--;
+    t->node.gen++;
+    t->used = 0;
+    t->hnext = g_free_head;
+    g_free_head = (uint16_t)(inode_id(t) + 1u);
+}
+
+static size_t tmpfs_read(vfs_node_t* node, size_t offset, size_t size, uint8_t* out) {
+    tmpfs_inode_t* t = (tmpfs_inode_t*)node->impl;
+    if (offset >= node->size) return 0;
+    if (size > node->size - offset) size = node->size - offset;
+
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t pos = (uint32_t)offset + done;
+        uint32_t in = pos % FRAME_SIZE;
+        uint32_t n = FRAME_SIZE - in;
+        if (n > size - done) n = (uint32_t)size - done;
+
+        uint8_t** slot = page_slot(t, pos / FRAME_SIZE, 0);
+        const uint8_t* page = slot ? *slot : 0;
+        if (page) kmemcpy(out + done, page + in, n);
+        else kmemset(out + done, 0, n);
+        done += n;
+    }
+    return done;
+}
+
+static size_t tmpfs_write(vfs_node_t* node, size_t offset, size_t size, const uint8_t* data) {
+    tmpfs_inode_t* t = (tmpfs_inode_t*)node->impl;
+    if (offset >= TMPFS_FILE_PAGES * FRAME_SIZE) return 0;
+    if (size > TMPFS_FILE_PAGES * FRAME_SIZE - offset) size = TMPFS_FILE_PAGES * FRAME_SIZE - offset;
+
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t pos = (uint32_t)offset + done;
+        uint32_t in = pos % FRAME_SIZE;
+        uint32_t n = FRAME_SIZE - in;
+        if (n > size - done) n = (uint32_t)size - done;
+
+        uint8_t** slot = page_slot(t, pos / FRAME_SIZE, 1);
+        if (!slot) break;
+        if (!*slot) {
+            *slot = (uint8_t*)frame_alloc();
+            if (!*slot) break;
+            if (n != FRAME_SIZE) kmemset(*slot, 0, FRAME_SIZE);
+            g_pages++;
+        }
+        kmemcpy(*slot + in, data + done, n);
+        done += n;
+    }
+
+    if (offset + done > node->size) node->size = (uint32_t)offset + done;
+    return done;
+}
+
+static void tmpfs_close(vfs_node_t* node) {
+    tmpfs_inode_t* t = (tmpfs_inode_t*)node->impl;
+    if (t->refs > 0) t->refs--;
+    if (t->unlinked && t->refs == 0) inode_free(t);
+}
+
+static vfs_node_t* inode_ref(tmpfs_inode_t* t) {
+    if (t->node.type == VFS_NODE_FILE) t->refs++;
+    return &t->node;
+}
+
+static vfs_node_t* tmpfs_finddir(vfs_node_t* dir, const char* name) {
+    tmpfs_inode_t* d = (tmpfs_inode_t*)dir->impl;
+    if (name[0] == '.' && name[1] == '.' && name[2] == '\0') return &g_inodes[d->parent].node;
+
+    tmpfs_inode_t* t = index_lookup(inode_id(d), name);
+    return t ? inode_ref(t) : 0;
+}
+
+static int32_t tmpfs_readdir(vfs_node_t* dir, uint32_t* cookie, vfs_dirent_t* out, uint32_t max) {
+    tmpfs_inode_t* d = (tmpfs_inode_t*)dir->impl;
+    uint16_t id = inode_id(d);
+    uint32_t n = 0;
+
+    if (*cookie == 0) *cookie = 1;
+    while (n < max && *cookie < TMPFS_MAX_NODES) {
+        const tmpfs_inode_t* t = &g_inodes[(*cookie)++];
+        if (!t->used || t->unlinked || t->parent != id) continue;
+        kstrncpy(out[n].name, t->node.name, sizeof(out[n].name));
+        out[n].type = t->node.type;
+        out[n].size = t->node.size;
+        out[n].ino = t->node.ino;
+        n++;
+    }
+    return (int32_t)n;
+}
+
+static vfs_node_t* tmpfs_create(vfs_node_t* dir, const char* name, vfs_node_type_t type) {
+    tmpfs_inode_t* d = (tmpfs_inode_t*)dir->impl;
+    if (d->unlinked || !d->used) return 0;
+
+    tmpfs_inode_t* t = index_lookup(inode_id(d), name);
+    if (t) return (t->node.type == type) ? inode_ref(t) : 0;
+
+    if (g_free_head == 0) return 0;
+    t = &g_inodes[g_free_head - 1u];
+    g_free_head = t->hnext;
+
+    uint32_t gen = t->node.gen;
+    kmemset(t, 0, sizeof(*t));
+    kstrncpy(t->node.name, name, sizeof(t->node.name));
+    t->node.hash = vfs_name_hash(t->node.name);
+    t->node.type = type;
+    t->node.gen = gen + 1u;
+    t->node.ino = inode_id(t);
+    t->node.impl = t;
+    if (type == VFS_NODE_DIR) {
+        t->node.finddir = tmpfs_finddir;
+        t->node.create = tmpfs_create;
+        t->node.unlink = tmpfs_unlink;
+        t->node.readdir = tmpfs_readdir;
+    } else {
+        t->node.read = tmpfs_read;
+        t->node.write = tmpfs_write;
+        t->node.close = tmpfs_close;
+        g_files++;
+    }
+    t->parent = inode_id(d);
+    t->used = 1;
+    index_insert(t);
+    d->children++;
+    return inode_ref(t);
+}
+
+static int tmpfs_unlink(vfs_node_t* dir, const char* name) {
+    tmpfs_inode_t* d = (tmpfs_inode_t*)dir->impl;
+    tmpfs_inode_t* t = index_lookup(inode_id(d), name);
+    if (!t || t->children > 0) return -1;
+
+    index_remove(t);
+    d->children--;
+    t->unlinked = 1;
+    if (t->refs == 0) inode_free(t);
+    return 0;
+}
+
+int tmpfs_init(void) {
+    kmemset(g_buckets, 0, sizeof(g_buckets));
+    g_files = 0;
+    g_pages = 0;
+    g_free_head = 0;
+    for (uint32_t i = TMPFS_MAX_NODES - 1u; i > 0; i--) {
+        if (g_inodes[i].used) continue;
+        g_inodes[i].hnext = g_free_head;
+        g_free_head = (uint16_t)(i + 1u);
+    }
+
+    tmpfs_inode_t* root = &g_inodes[0];
+    kmemset(root, 0, sizeof(*root));
+    kstrncpy(root->node.name, "tmp", sizeof(root->node.name));
+    root->node.type = VFS_NODE_DIR;
+    root->node.finddir = tmpfs_finddir;
+    root->node.create = tmpfs_create;
+    root->node.unlink = tmpfs_unlink;
+    root->node.readdir = tmpfs_readdir;
+    root->node.impl = root;
+    root->used = 1;
+    return vfs_mount(TMPFS_MOUNT_PATH, &root->node);
+}
+
+void tmpfs_usage(uint32_t* files, uint32_t* pages) {
+    if (files) *files = g_files;
+    if (pages) *pages = g_pages;
+}
@@ -0,0 +1,9 @@
+#pragma once
+#include <stdint.h>
+
+#define TMPFS_MOUNT_PATH "/tmp"
+#define TMPFS_MAX_NODES  1024u
+#define TMPFS_BUCKETS    2048u
+
+int  tmpfs_init(void);
+void tmpfs_usage(uint32_t* files, uint32_t* pages);
@@ -1,4 +1,5 @@
 #include "vfs.h"
+#include "pcache.h"
 #include "../vga.h"
 #include "../debug/print.h"
 #include "../lib/string.h"
@@ -6,42 +7,475 @@
 static vfs_node_t* g_nodes[VFS_MAX_NODES];
 static unsigned g_node_count = 0;
 
+static uint16_t g_hash[VFS_MAX_NODES * 2];
+static unsigned g_hash_cap = VFS_HASH_MIN;
+
+typedef struct {
+    char path[VFS_MOUNT_PATH];
+    uint32_t len;
+    vfs_node_t* root;
+} vfs_mount_t;
+
+typedef struct {
+    uint32_t hash;
+    uint32_t len;
+    uint32_t gen;
+    vfs_node_t* node;
+    char path[VFS_PATHCACHE_PATH];
+} vfs_pathcache_t;
+
+typedef struct {
+    vfs_node_t* node;
+    uint32_t gen;
+    uint32_t pos;
+    vfs_advice_t advice;
+} vfs_fd_t;
+
+static vfs_mount_t g_mounts[VFS_MAX_MOUNTS];
+static vfs_fd_t g_fds[VFS_MAX_FDS];
+static vfs_pathcache_t g_pathcache[VFS_PATHCACHE_SLOTS];
+static vfs_node_t g_registry_root;
+static vfs_node_t* g_cwd;
+static vfs_stats_t g_stats;
+static uint32_t g_next_dev = 1;
+
+static int path_eq(const char* a, const char* b, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        if (a[i] != b[i]) return 0;
+    }
+    return 1;
+}
+
+static void pathcache_clear(void) {
+    for (unsigned i = 0; i < VFS_PATHCACHE_SLOTS; i++) g_pathcache[i].node = 0;
+}
+
 void vfs_init(void) {
     g_node_count = 0;
     for (unsigned i = 0; i < VFS_MAX_NODES; i++) g_nodes[i] = 0;
+    g_hash_cap = VFS_HASH_MIN;
+    kmemset(g_hash, 0, sizeof(g_hash));
+    pathcache_clear();
+    g_cwd = 0;
+}
+
+uint32_t vfs_name_hash(const char* name) {
+    uint32_t h = 2166136261u;
+    while (*name) {
+        h ^= (uint8_t)*name++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static void hash_insert(unsigned idx) {
+    unsigned mask = g_hash_cap - 1u;
+    unsigned b = g_nodes[idx]->hash & mask;
+    while (g_hash[b] != 0) b = (b + 1u) & mask;
+    g_hash[b] = (uint16_t)(idx + 1u);
+}
+
+static void hash_grow(void) {
+    g_hash_cap *= 2u;
+    kmemset(g_hash, 0, g_hash_cap * sizeof(g_hash[0]));
+    for (unsigned i = 0; i < g_node_count; i++) hash_insert(i);
+}
+
+static vfs_node_t* hash_lookup(const char* name) {
+    uint32_t h = vfs_name_hash(name);
+    unsigned mask = g_hash_cap - 1u;
+    unsigned b = h & mask;
+    while (g_hash[b] != 0) {
+        vfs_node_t* n = g_nodes[g_hash[b] - 1u];
+        if (n->hash == h && kstrcmp(n->name, name) == 0) return n;
+        b = (b + 1u) & mask;
+    }
+    return 0;
+}
+
+static vfs_node_t* registry_finddir(vfs_node_t* dir, const char* name) {
+    (void)dir;
+    return hash_lookup(name);
+}
+
+static int32_t registry_readdir(vfs_node_t* dir, uint32_t* cookie, vfs_dirent_t* out, uint32_t max) {
+    (void)dir;
+    uint32_t n = 0;
+    while (n < max && *cookie < g_node_count) {
+        const vfs_node_t* node = g_nodes[(*cookie)++];
+        kstrncpy(out[n].name, node->name, sizeof(out[n].name));
+        out[n].type = node->type;
+        out[n].size = node->size;
+        out[n].ino = node->ino;
+        n++;
+    }
+    return (int32_t)n;
+}
+
+vfs_node_t* vfs_registry_root(void) {
+    vfs_node_t* r = &g_registry_root;
+    if (r->type != VFS_NODE_DIR) {
+        kstrncpy(r->name, "registry", sizeof(r->name));
+        r->type = VFS_NODE_DIR;
+        r->finddir = registry_finddir;
+        r->readdir = registry_readdir;
+    }
+    return r;
+}
+
+int vfs_mount(const char* path, vfs_node_t* root) {
+    if (!path || path[0] != '/' || !root || root->type != VFS_NODE_DIR) return -1;
+    uint32_t len = (uint32_t)kstrlen(path);
+    while (len > 1 && path[len - 1] == '/') len--;
+    if (len >= VFS_MOUNT_PATH) return -1;
+
+    vfs_mount_t* slot = 0;
+    for (unsigned i = 0; i < VFS_MAX_MOUNTS; i++) {
+        vfs_mount_t* m = &g_mounts[i];
+        if (m->root && m->len == len && path_eq(m->path, path, len)) {
+            slot = m;
+            break;
+        }
+        if (!slot && !m->root) slot = m;
+    }
+    if (!slot) return -1;
+
+    kstrncpy(slot->path, path, sizeof(slot->path));
+    slot->path[len] = '\0';
+    slot->len = len;
+    slot->root = root;
+    pathcache_clear();
+    return 0;
+}
+
+int vfs_unmount(const char* path) {
+    if (!path) return -1;
+    for (unsigned i = 0; i < VFS_MAX_MOUNTS; i++) {
+        if (g_mounts[i].root && kstrcmp(g_mounts[i].path, path) == 0) {
+            g_mounts[i].root = 0;
+            pathcache_clear();
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void vfs_set_cwd(vfs_node_t* dir) {
+    if (!dir || dir->type == VFS_NODE_DIR) g_cwd = dir;
+}
+
+static const vfs_mount_t* find_mount(const char* path) {
+    const vfs_mount_t* best = 0;
+    for (unsigned i = 0; i < VFS_MAX_MOUNTS; i++) {
+        const vfs_mount_t* m = &g_mounts[i];
+        if (!m->root || (best && m->len <= best->len)) continue;
+        if (!path_eq(path, m->path, m->len)) continue;
+        if (m->len > 1 && path[m->len] != '/' && path[m->len] != '\0') continue;
+        best = m;
+    }
+    return best;
+}
+
+static vfs_pathcache_t* pathcache_slot(uint32_t hash) {
+    return &g_pathcache[hash & (VFS_PATHCACHE_SLOTS - 1u)];
+}
+
+static vfs_node_t* pathcache_lookup(const char* path, uint32_t len, uint32_t hash) {
+    vfs_pathcache_t* e = pathcache_slot(hash);
+    if (!e->node || e->hash != hash || e->len != len) return 0;
+    if (e->node->gen != e->gen || !path_eq(e->path, path, len)) return 0;
+    return e->node;
+}
+
+static void pathcache_insert(const char* path, uint32_t len, uint32_t hash, vfs_node_t* node) {
+    if (len >= VFS_PATHCACHE_PATH) return;
+    vfs_pathcache_t* e = pathcache_slot(hash);
+    kstrncpy(e->path, path, len);
+    e->path[len] = '\0';
+    e->len = len;
+    e->hash = hash;
+    e->gen = node->gen;
+    e->node = node;
+}
+
+static vfs_node_t* walk(vfs_node_t* cur, const char* path, uint32_t pos, int cached) {
+    g_stats.walks++;
+
+    uint32_t ends[VFS_MAX_DEPTH];
+    uint32_t hashes[VFS_MAX_DEPTH];
+    uint32_t depth = 0;
+
+    uint32_t h = 2166136261u;
+    for (uint32_t i = 0; path[i]; i++) {
+        h ^= (uint8_t)path[i];
+        h *= 16777619u;
+        if (i < pos || path[i] == '/') continue;
+        if (path[i + 1] != '/' && path[i + 1] != '\0') continue;
+        if (depth >= VFS_MAX_DEPTH) return 0;
+        ends[depth] = i + 1u;
+        hashes[depth] = h;
+        depth++;
+    }
+
+    uint32_t k = cached ? depth : 0;
+    while (k > 0) {
+        vfs_node_t* hit = pathcache_lookup(path, ends[k - 1u], hashes[k - 1u]);
+        if (hit) {
+            cur = hit;
+            pos = ends[k - 1u];
+            g_stats.prefix_hits++;
+            break;
+        }
+        k--;
+    }
+
+    for (; k < depth; k++) {
+        if (cur->type != VFS_NODE_DIR || !cur->finddir) {
+            vfs_close(cur);
+            return 0;
+        }
+        while (path[pos] == '/') pos++;
+
+        char comp[VFS_NAME_MAX];
+        uint32_t n = ends[k] - pos;
+        if (n >= sizeof(comp)) return 0;
+        kmemcpy(comp, path + pos, n);
+        comp[n] = '\0';
+        pos = ends[k];
+
+        if (comp[0] == '.' && comp[1] == '\0') continue;
+
+        vfs_node_t* next = cur->finddir(cur, comp);
+        g_stats.components++;
+        if (!next) return 0;
+        cur = next;
+        if (cached && cur->type == VFS_NODE_DIR) pathcache_insert(path, pos, hashes[k], cur);
+    }
+    return cur;
 }
 
 int vfs_register(vfs_node_t* node) {
     if (!node) return -1;
     if (g_node_count >= VFS_MAX_NODES) return -1;
-    g_nodes[g_node_count++] = node;
+
+    node->hash = vfs_name_hash(node->name);
+    if (hash_lookup(node->name)) return -1;
+
+    if ((g_node_count + 1u) * 2u > g_hash_cap) hash_grow();
+    g_nodes[g_node_count] = node;
+    hash_insert(g_node_count);
+    g_node_count++;
     return 0;
 }
 
-vfs_node_t* vfs_open(const char* name) {
-    if (!name || !*name) return 0;
-    for (unsigned i = 0; i < g_node_count; i++) {
-        if (g_nodes[i] && kstrcmp(g_nodes[i]->name, name) == 0) return g_nodes[i];
+vfs_node_t* vfs_open(const char* path) {
+    if (!path || !*path) return 0;
+    if (path[0] != '/') return walk(g_cwd ? g_cwd : vfs_registry_root(), path, 0, 0);
+
+    const vfs_mount_t* m = find_mount(path);
+    if (!m) return 0;
+    return walk(m->root, path, m->len, 1);
+}
+
+static vfs_node_t* open_parent(const char* path, const char** leaf) {
+    const char* slash = 0;
+    for (const char* p = path; *p; p++) {
+        if (*p == '/') slash = p;
     }
-    return 0;
+    if (slash && slash[1] == '\0') return 0;
+    if (!slash) {
+        *leaf = path;
+        return g_cwd ? g_cwd : vfs_registry_root();
+    }
+
+    char dir[VFS_PATHCACHE_PATH * 2];
+    uint32_t n = (uint32_t)(slash - path);
+    if (n >= sizeof(dir)) return 0;
+    kmemcpy(dir, path, n);
+    dir[n] = '\0';
+    if (n == 0) {
+        dir[0] = '/';
+        dir[1] = '\0';
+    }
+
+    *leaf = slash + 1;
+    vfs_node_t* parent = vfs_open(dir);
+    if (parent && parent->type != VFS_NODE_DIR) {
+        vfs_close(parent);
+        return 0;
+    }
+    return parent;
+}
+
+vfs_node_t* vfs_create(const char* path, vfs_node_type_t type) {
+    if (!path || !*path) return 0;
+    const char* leaf;
+    vfs_node_t* dir = open_parent(path, &leaf);
+    if (!dir || !dir->create || kstrlen(leaf) >= VFS_NAME_MAX) return 0;
+    if (leaf[0] == '.' && (leaf[1] == '\0' || (leaf[1] == '.' && leaf[2] == '\0'))) return 0;
+    return dir->create(dir, leaf, type);
+}
+
+int vfs_unlink(const char* path) {
+    if (!path || !*path) return -1;
+    const char* leaf;
+    vfs_node_t* dir = open_parent(path, &leaf);
+    if (!dir || !dir->unlink) return -1;
+    return dir->unlink(dir, leaf);
+}
+
+void vfs_close(vfs_node_t* node) {
+    if (!node) return;
+    pcache_release(node);
+    if (node->close) node->close(node);
 }
 
 size_t vfs_read(vfs_node_t* node, size_t offset, size_t size, uint8_t* out) {
     if (!node || node->type != VFS_NODE_FILE || !node->read) return 0;
+    if (node->dev) return pcache_read(node, (uint32_t)offset, (uint32_t)size, out);
     return node->read(node, offset, size, out);
 }
 
-void vfs_list(void) {
-    if (g_node_count == 0) {
-        vga_puts("(empty)\n");
-        return;
+size_t vfs_write(vfs_node_t* node, size_t offset, size_t size, const uint8_t* data) {
+    if (!node || node->type != VFS_NODE_FILE || !node->write) return 0;
+    if (node->dev) return pcache_write(node, (uint32_t)offset, (uint32_t)size, data);
+    return node->write(node, offset, size, data);
+}
+
+int vfs_sync(void) {
+    return pcache_sync(0, PCACHE_ALL);
+}
+
+uint32_t vfs_alloc_dev(void) {
+    return g_next_dev++;
+}
+
+int vfs_map(vfs_node_t* node, const uint8_t** ptr, uint32_t* len) {
+    if (!node || node->type != VFS_NODE_FILE || !node->map || !ptr || !len) return -1;
+    return node->map(node, ptr, len);
+}
+
+void vfs_get_stats(vfs_stats_t* out) {
+    if (out) *out = g_stats;
+}
+
+int vfs_stat(const char* path, vfs_stat_t* out) {
+    if (!out) return -1;
+    vfs_node_t* n = vfs_open(path);
+    if (!n) return -1;
+    out->type = n->type;
+    out->size = n->size;
+    out->dev = n->dev;
+    out->ino = n->ino;
+    vfs_close(n);
+    return 0;
+}
+
+static vfs_fd_t* fd_get(int fd) {
+    if (fd < 0 || fd >= (int)VFS_MAX_FDS || !g_fds[fd].node) return 0;
+    return &g_fds[fd];
+}
+
+static int fd_open_type(const char* path, vfs_node_type_t type) {
+    int fd = -1;
+    for (unsigned i = 0; i < VFS_MAX_FDS; i++) {
+        if (!g_fds[i].node) {
+            fd = (int)i;
+            break;
+        }
     }
-    for (unsigned i = 0; i < g_node_count; i++) {
-        vfs_node_t* n = g_nodes[i];
-        if (!n) continue;
-        vga_puts(n->name);
-        vga_puts("  ");
-        kprint_dec(n->size);
-        vga_puts(" bytes\n");
+    if (fd < 0) return -1;
+
+    vfs_node_t* n = vfs_open(path);
+    if (!n) return -1;
+    if (n->type != type) {
+        vfs_close(n);
+        return -1;
     }
+
+    g_fds[fd].node = n;
+    g_fds[fd].gen = n->gen;
+    g_fds[fd].pos = 0;
+    g_fds[fd].advice = VFS_ADVICE_NORMAL;
+    return fd;
+}
+
+int vfs_fd_open(const char* path) {
+    return fd_open_type(path, VFS_NODE_FILE);
+}
+
+int32_t vfs_fd_pread(int fd, void* out, uint32_t size, uint32_t offset) {
+    vfs_fd_t* f = fd_get(fd);
+    if (!f || !out) return -1;
+    return (int32_t)vfs_read(f->node, offset, size, (uint8_t*)out);
+}
+
+int32_t vfs_fd_read(int fd, void* out, uint32_t size) {
+    vfs_fd_t* f = fd_get(fd);
+    if (!f || !out) return -1;
+    size_t got = vfs_read(f->node, f->pos, size, (uint8_t*)out);
+    f->pos += (uint32_t)got;
+    return (int32_t)got;
+}
+
+int32_t vfs_fd_write(int fd, const void* data, uint32_t size) {
+    vfs_fd_t* f = fd_get(fd);
+    if (!f || !data) return -1;
+    size_t put = vfs_write(f->node, f->pos, size, (const uint8_t*)data);
+    f->pos += (uint32_t)put;
+    return (int32_t)put;
+}
+
+int32_t vfs_fd_seek(int fd, int32_t offset, vfs_whence_t whence) {
+    vfs_fd_t* f = fd_get(fd);
+    if (!f) return -1;
+
+    int32_t base;
+    if (whence == VFS_SEEK_SET) base = 0;
+    else if (whence == VFS_SEEK_CUR) base = (int32_t)f->pos;
+    else if (whence == VFS_SEEK_END) base = (int32_t)f->node->size;
+    else return -1;
+
+    if (offset < 0 && base + offset < 0) return -1;
+    f->pos = (uint32_t)(base + offset);
+    return (int32_t)f->pos;
+}
+
+int vfs_fd_advise(int fd, vfs_advice_t advice) {
+    vfs_fd_t* f = fd_get(fd);
+    if (!f) return -1;
+    f->advice = advice;
+    if (f->node->advise) f->node->advise(f->node, advice);
+    return 0;
+}
+
+int vfs_fd_map(int fd, const uint8_t** ptr, uint32_t* len) {
+    vfs_fd_t* f = fd_get(fd);
+    if (!f) return -1;
+    return vfs_map(f->node, ptr, len);
+}
+
+int vfs_fd_close(int fd) {
+    vfs_fd_t* f = fd_get(fd);
+    if (!f) return -1;
+    vfs_close(f->node);
+    f->node = 0;
+    return 0;
+}
+
+int vfs_opendir(const char* path) {
+    return fd_open_type(path, VFS_NODE_DIR);
+}
+
+int32_t vfs_readdir(int fd, vfs_dirent_t* out, uint32_t max) {
+    vfs_fd_t* f = fd_get(fd);
+    if (!f || !out || f->node->type != VFS_NODE_DIR) return -1;
+    /* Directory nodes can be recycled by their filesystem under an open fd. */
+    if (f->node->gen != f->gen) return -1;
+    if (!f->node->readdir) return 0;
+    return f->node->readdir(f->node, &f->pos, out, max);
+}
+
+int vfs_closedir(int fd) {
+    return vfs_fd_close(fd);
 }
@@ -2,25 +2,114 @@
 #include <stdint.h>
 #include <stddef.h>
 
-#define VFS_MAX_NODES 64
+#define VFS_MAX_NODES 4096
+#define VFS_HASH_MIN  16
+#define VFS_NAME_MAX 64
+#define VFS_MAX_MOUNTS 8
+#define VFS_MOUNT_PATH 32
+#define VFS_MAX_DEPTH 16
+#define VFS_PATHCACHE_SLOTS 64
+#define VFS_PATHCACHE_PATH 64
+#define VFS_MAX_FDS 16
 
 typedef enum {
     VFS_NODE_FILE = 1,
+    VFS_NODE_DIR = 2,
 } vfs_node_type_t;
 
+typedef enum {
+    VFS_ADVICE_NORMAL = 0,
+    VFS_ADVICE_SEQUENTIAL = 1,
+    VFS_ADVICE_RANDOM = 2,
+} vfs_advice_t;
+
+typedef enum {
+    VFS_SEEK_SET = 0,
+    VFS_SEEK_CUR = 1,
+    VFS_SEEK_END = 2,
+} vfs_whence_t;
+
+typedef struct {
+    char name[VFS_NAME_MAX];
+    vfs_node_type_t type;
+    uint32_t size;
+    uint32_t ino;
+} vfs_dirent_t;
+
+typedef struct {
+    vfs_node_type_t type;
+    uint32_t size;
+    uint32_t dev;
+    uint32_t ino;
+} vfs_stat_t;
+
 struct vfs_node;
 typedef size_t (*vfs_read_fn)(struct vfs_node* node, size_t offset, size_t size, uint8_t* out);
+typedef size_t (*vfs_write_fn)(struct vfs_node* node, size_t offset, size_t size, const uint8_t* data);
+typedef void (*vfs_close_fn)(struct vfs_node* node);
+typedef struct vfs_node* (*vfs_finddir_fn)(struct vfs_node* dir, const char* name);
+typedef void (*vfs_advise_fn)(struct vfs_node* node, vfs_advice_t advice);
+typedef int (*vfs_map_fn)(struct vfs_node* node, const uint8_t** ptr, uint32_t* len);
+typedef struct vfs_node* (*vfs_create_fn)(struct vfs_node* dir, const char* name, vfs_node_type_t type);
+typedef int (*vfs_unlink_fn)(struct vfs_node* dir, const char* name);
+typedef int (*vfs_sync_fn)(struct vfs_node* node);
+typedef int32_t (*vfs_readdir_fn)(struct vfs_node* dir, uint32_t* cookie, vfs_dirent_t* out, uint32_t max);
 
 typedef struct vfs_node {
-    char name[32];
+    char name[VFS_NAME_MAX];
+    uint32_t hash;
     vfs_node_type_t type;
     uint32_t size;
+    uint32_t gen;
+    uint32_t dev;
+    uint32_t ino;
     vfs_read_fn read;
+    vfs_write_fn write;
+    vfs_close_fn close;
+    vfs_finddir_fn finddir;
+    vfs_create_fn create;
+    vfs_unlink_fn unlink;
+    vfs_readdir_fn readdir;
+    vfs_advise_fn advise;
+    vfs_map_fn map;
+    vfs_sync_fn sync;
     void* impl;
 } vfs_node_t;
 
+typedef struct {
+    uint32_t walks;
+    uint32_t components;
+    uint32_t prefix_hits;
+} vfs_stats_t;
+
 void vfs_init(void);
 int  vfs_register(vfs_node_t* node);
-vfs_node_t* vfs_open(const char* name);
-void vfs_list(void);
+vfs_node_t* vfs_registry_root(void);
+int  vfs_mount(const char* path, vfs_node_t* root);
+int  vfs_unmount(const char* path);
+void vfs_set_cwd(vfs_node_t* dir);
+vfs_node_t* vfs_open(const char* path);
+void vfs_close(vfs_node_t* node);
+vfs_node_t* vfs_create(const char* path, vfs_node_type_t type);
+int  vfs_unlink(const char* path);
+uint32_t vfs_name_hash(const char* name);
 size_t vfs_read(vfs_node_t* node, size_t offset, size_t size, uint8_t* out);
+size_t vfs_write(vfs_node_t* node, size_t offset, size_t size, const uint8_t* data);
+int  vfs_sync(void);
+uint32_t vfs_alloc_dev(void);
+int  vfs_map(vfs_node_t* node, const uint8_t** ptr, uint32_t* len);
+void vfs_get_stats(vfs_stats_t* out);
+int  vfs_stat(const char* path, vfs_stat_t* out);
+
+int     vfs_fd_open(const char* path);
+int32_t vfs_fd_read(int fd, void* out, uint32_t size);
+int32_t vfs_fd_pread(int fd, void* out, uint32_t size, uint32_t offset);
+int32_t vfs_fd_write(int fd, const void* data, uint32_t size);
+int32_t vfs_fd_seek(int fd, int32_t offset, vfs_whence_t whence);
+int     vfs_fd_advise(int fd, vfs_advice_t advice);
+int     vfs_fd_map(int fd, const uint8_t** ptr, uint32_t* len);
+int     vfs_fd_close(int fd);
+
+int     vfs_opendir(const char* path);
+int32_t vfs_readdir(int fd, vfs_dirent_t* out, uint32_t max);
+int     vfs_closedir(int fd);
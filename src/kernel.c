@@ -4,15 +4,23 @@
 #include "arch/i386/gdt.h"
 #include "arch/i386/idt.h"
 #include "arch/i386/irq.h"
+#include "arch/i386/cpu.h"
+#include "arch/i386/fpu.h"
 #include "drivers/timer.h"
 #include "drivers/keyboard.h"
 #include "drivers/mouse.h"
 #include "shell.h"
 #include "memory/paging.h"
+#include "memory/frame.h"
+#include "fs/pcache.h"
 #include "debug/print.h"
 
 #include "boot/multiboot.h"
 #include "fs/initrd.h"
+#include "fs/tmpfs.h"
+#include "lib/crc32c.h"
+#include "lib/stream.h"
+#include "lib/string.h"
 
 #include "drivers/ata.h"
 
@@ -27,6 +35,10 @@ void kmain(uint32_t mb_magic, uint32_t mb_info_addr)
     gdt_init();
     idt_init();
     irq_init();
+    cpu_init();
+    uint32_t fpu = fpu_init();
+    string_init();
+    stream_init();
 
     if (mb_magic == MB_BOOTLOADER_MAGIC) {
         mb = (const multiboot_info_t*)(uintptr_t)mb_info_addr;
@@ -39,9 +51,15 @@ void kmain(uint32_t mb_magic, uint32_t mb_info_addr)
     }
 
     paging_init(fb_base, fb_size);
+    frame_init(mb);
+    pcache_init();
+    crc32c_init();
 
     vga_init(mb);
     vga_puts("DiellOS v0.5 Console\n");
+    if (fpu & FPU_SSE2) vga_puts("[cpu] SSE2 enabled\n");
+    else if (fpu & FPU_SSE) vga_puts("[cpu] SSE enabled\n");
+    else vga_puts("[cpu] no SSE; using scalar paths\n");
 
     console_init();
 
@@ -50,6 +68,9 @@ void kmain(uint32_t mb_magic, uint32_t mb_info_addr)
     } else {
         vga_puts("[boot] invalid multiboot magic; initrd skipped\n");
     }
+    if (tmpfs_init() != 0) {
+        vga_puts("[boot] tmpfs mount failed\n");
+    }
 
     vga_puts("[display] ");
     kprint_dec(vga_cols());
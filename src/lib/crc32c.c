@@ -0,0 +1,128 @@
+#include "crc32c.h"
+#include "../arch/i386/cpu.h"
+
+#define CRC32C_POLY   0x82F63B78u
+#define CRC32C_STRIDE 1024u
+
+typedef uint32_t __attribute__((may_alias)) crc_word_t;
+typedef uint32_t (*crc_fn)(uint32_t crc, const uint8_t* p, size_t len);
+
+static uint32_t g_slice[8][256];
+static uint32_t g_shift[4][256];
+static crc_fn g_fn;
+static const char* g_name;
+
+static uint32_t crc_slice8(uint32_t crc, const uint8_t* p, size_t len) {
+    while (len > 0 && ((uintptr_t)p & 3u)) {
+        crc = (crc >> 8) ^ g_slice[0][(crc ^ *p++) & 0xFFu];
+        len--;
+    }
+    while (len >= 8) {
+        uint32_t a = ((const crc_word_t*)p)[0] ^ crc;
+        uint32_t b = ((const crc_word_t*)p)[1];
+        crc = g_slice[7][a & 0xFFu] ^ g_slice[6][(a >> 8) & 0xFFu] ^
+              g_slice[5][(a >> 16) & 0xFFu] ^ g_slice[4][a >> 24] ^
+              g_slice[3][b & 0xFFu] ^ g_slice[2][(b >> 8) & 0xFFu] ^
+              g_slice[1][(b >> 16) & 0xFFu] ^ g_slice[0][b >> 24];
+        p += 8;
+        len -= 8;
+    }
+    while (len-- > 0) crc = (crc >> 8) ^ g_slice[0][(crc ^ *p++) & 0xFFu];
+    return crc;
+}
+
+static inline uint32_t hw_crc8(uint32_t crc, uint8_t v) {
+    __asm__ ("crc32b %1, %0" : "+r"(crc) : "rm"(v));
+    return crc;
+}
+
+static inline uint32_t hw_crc32(uint32_t crc, uint32_t v) {
+    __asm__ ("crc32l %1, %0" : "+r"(crc) : "rm"(v));
+    return crc;
+}
+
+static uint32_t shift_stride(uint32_t crc) {
+    return g_shift[0][crc & 0xFFu] ^ g_shift[1][(crc >> 8) & 0xFFu] ^
+           g_shift[2][(crc >> 16) & 0xFFu] ^ g_shift[3][crc >> 24];
+}
+
+static uint32_t crc_sse42(uint32_t crc, const uint8_t* p, size_t len) {
+    while (len > 0 && ((uintptr_t)p & 3u)) {
+        crc = hw_crc8(crc, *p++);
+        len--;
+    }
+
+    /* crc32 has a 3-cycle latency, so run three independent streams and
+       fold them together with the stride shift table. */
+    while (len >= 3u * CRC32C_STRIDE) {
+        const crc_word_t* w = (const crc_word_t*)p;
+        uint32_t b = 0;
+        uint32_t c = 0;
+        for (uint32_t i = 0; i < CRC32C_STRIDE / 4u; i++) {
+            crc = hw_crc32(crc, w[i]);
+            b = hw_crc32(b, w[i + CRC32C_STRIDE / 4u]);
+            c = hw_crc32(c, w[i + CRC32C_STRIDE / 2u]);
+        }
+        crc = shift_stride(shift_stride(crc) ^ b) ^ c;
+        p += 3u * CRC32C_STRIDE;
+        len -= 3u * CRC32C_STRIDE;
+    }
+
+    while (len >= 4) {
+        crc = hw_crc32(crc, *(const crc_word_t*)p);
+        p += 4;
+        len -= 4;
+    }
+    while (len-- > 0) crc = hw_crc8(crc, *p++);
+    return crc;
+}
+
+static void build_shift(void) {
+    uint32_t basis[32];
+    for (uint32_t bit = 0; bit < 32; bit++) {
+        uint32_t crc = 1u << bit;
+        for (uint32_t i = 0; i < CRC32C_STRIDE; i++) crc = (crc >> 8) ^ g_slice[0][crc & 0xFFu];
+        basis[bit] = crc;
+    }
+    for (uint32_t k = 0; k < 4; k++) {
+        for (uint32_t v = 0; v < 256; v++) {
+            uint32_t r = 0;
+            for (uint32_t bit = 0; bit < 8; bit++) {
+                if (v & (1u << bit)) r ^= basis[k * 8u + bit];
+            }
+            g_shift[k][v] = r;
+        }
+    }
+}
+
+void crc32c_init(void) {
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int b = 0; b < 8; b++) crc = (crc >> 1) ^ ((crc & 1u) ? CRC32C_POLY : 0);
+        g_slice[0][i] = crc;
+    }
+    for (uint32_t i = 0; i < 256; i++) {
+        for (uint32_t k = 1; k < 8; k++) {
+            g_slice[k][i] = (g_slice[k - 1][i] >> 8) ^ g_slice[0][g_slice[k - 1][i] & 0xFFu];
+        }
+    }
+    build_shift();
+
+    if (cpu_has(CPU_SSE42)) {
+        g_fn = crc_sse42;
+        g_name = "sse4.2";
+    } else {
+        g_fn = crc_slice8;
+        g_name = "slice-by-8";
+    }
+}
+
+uint32_t crc32c(uint32_t crc, const void* data, size_t len) {
+    if (!g_fn) crc32c_init();
+    return ~g_fn(~crc, (const uint8_t*)data, len);
+}
+
+const char* crc32c_impl(void) {
+    if (!g_fn) crc32c_init();
+    return g_name;
+}
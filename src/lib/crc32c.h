@@ -0,0 +1,7 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+void        crc32c_init(void);
+uint32_t    crc32c(uint32_t crc, const void* data, size_t len);
+const char* crc32c_impl(void);
@@ -0,0 +1,45 @@
+#include "lz4.h"
+#include "string.h"
+
+static int read_len(const uint8_t** ip, const uint8_t* iend, uint32_t* len) {
+    uint8_t b;
+    do {
+        if (*ip >= iend) return -1;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return 0;
+}
+
+int32_t lz4_decompress_block(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_cap) {
+    const uint8_t* ip = src;
+    const uint8_t* iend = src + src_len;
+    uint32_t op = 0;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        uint32_t lit = token >> 4;
+        if (lit == 15 && read_len(&ip, iend, &lit) != 0) return -1;
+        if (lit > (uint32_t)(iend - ip) || lit > dst_cap - op) return -1;
+        kmemcpy(dst + op, ip, lit);
+        ip += lit;
+        op += lit;
+        if (ip == iend) break;
+
+        if (iend - ip < 2) return -1;
+        uint32_t off = (uint32_t)ip[0] | ((uint32_t)ip[1] << 8);
+        ip += 2;
+        if (off == 0 || off > op) return -1;
+
+        uint32_t len = token & 15u;
+        if (len == 15 && read_len(&ip, iend, &len) != 0) return -1;
+        len += 4;
+        if (len > dst_cap - op) return -1;
+
+        const uint8_t* m = dst + op - off;
+        for (uint32_t i = 0; i < len; i++) dst[op + i] = m[i];
+        op += len;
+    }
+    return (int32_t)op;
+}
@@ -0,0 +1,4 @@
+#pragma once
+#include <stdint.h>
+
+int32_t lz4_decompress_block(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_cap);
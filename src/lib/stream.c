@@ -0,0 +1,172 @@
+#include "stream.h"
+#include "string.h"
+#include "../arch/i386/fpu.h"
+
+typedef struct {
+    void (*fill_rows)(uint8_t* dst, uint32_t pitch, uint32_t width, uint32_t height,
+                      uint32_t value);
+    void (*copy_rows)(uint8_t* dst, uint32_t dst_pitch, const uint8_t* src, uint32_t src_pitch,
+                      uint32_t row_bytes, uint32_t rows);
+    const char* name;
+} stream_ops_t;
+
+/* The kernel is built with -mno-sse, so the compiler never keeps values in
+   xmm registers and the asm blocks below do not list them as clobbers. */
+static void cached_fill32(uint32_t* d, uint32_t value, size_t count) {
+    __asm__ volatile ("rep stosl" : "+D"(d), "+c"(count) : "a"(value) : "memory");
+}
+
+static void nt_fill32(uint32_t* d, uint32_t value, size_t count) {
+    while (count && ((uintptr_t)d & 15u)) {
+        __asm__ volatile ("movnti %1, %0" : "=m"(*d) : "r"(value));
+        d++;
+        count--;
+    }
+
+    size_t blocks = count >> 4;
+    if (blocks) {
+        __asm__ volatile (
+            "movd %[v], %%xmm0\n\t"
+            "pshufd $0, %%xmm0, %%xmm0\n"
+            "1:\n\t"
+            "movntdq %%xmm0, (%[d])\n\t"
+            "movntdq %%xmm0, 16(%[d])\n\t"
+            "movntdq %%xmm0, 32(%[d])\n\t"
+            "movntdq %%xmm0, 48(%[d])\n\t"
+            "add $64, %[d]\n\t"
+            "dec %[n]\n\t"
+            "jnz 1b"
+            : [d] "+r"(d), [n] "+r"(blocks)
+            : [v] "r"(value)
+            : "cc", "memory");
+    }
+
+    count &= 15u;
+    while (count--) {
+        __asm__ volatile ("movnti %1, %0" : "=m"(*d) : "r"(value));
+        d++;
+    }
+}
+
+static void nt_copy(uint8_t* d, const uint8_t* s, size_t n) {
+    size_t head = (0u - (uintptr_t)d) & 3u;
+    if (head > n) head = n;
+    kmemcpy(d, s, head);
+    d += head;
+    s += head;
+    n -= head;
+
+    while (n >= 4 && ((uintptr_t)d & 15u)) {
+        uint32_t v = *(const uint32_t*)s;
+        __asm__ volatile ("movnti %1, %0" : "=m"(*(uint32_t*)d) : "r"(v));
+        d += 4;
+        s += 4;
+        n -= 4;
+    }
+
+    size_t blocks = n >> 6;
+    if (blocks) {
+        __asm__ volatile (
+            "1:\n\t"
+            "movdqu (%[s]), %%xmm0\n\t"
+            "movdqu 16(%[s]), %%xmm1\n\t"
+            "movdqu 32(%[s]), %%xmm2\n\t"
+            "movdqu 48(%[s]), %%xmm3\n\t"
+            "movntdq %%xmm0, (%[d])\n\t"
+            "movntdq %%xmm1, 16(%[d])\n\t"
+            "movntdq %%xmm2, 32(%[d])\n\t"
+            "movntdq %%xmm3, 48(%[d])\n\t"
+            "add $64, %[s]\n\t"
+            "add $64, %[d]\n\t"
+            "dec %[n]\n\t"
+            "jnz 1b"
+            : [d] "+r"(d), [s] "+r"(s), [n] "+r"(blocks)
+            :
+            : "cc", "memory");
+        n &= 63u;
+    }
+
+    while (n >= 4) {
+        uint32_t v = *(const uint32_t*)s;
+        __asm__ volatile ("movnti %1, %0" : "=m"(*(uint32_t*)d) : "r"(v));
+        d += 4;
+        s += 4;
+        n -= 4;
+    }
+    kmemcpy(d, s, n);
+}
+
+static void cached_fill_rows(uint8_t* dst, uint32_t pitch, uint32_t width, uint32_t height,
+                             uint32_t value) {
+    for (uint32_t y = 0; y < height; y++) {
+        cached_fill32((uint32_t*)dst, value, width);
+        dst += pitch;
+    }
+}
+
+static void cached_copy_rows(uint8_t* dst, uint32_t dst_pitch, const uint8_t* src,
+                             uint32_t src_pitch, uint32_t row_bytes, uint32_t rows) {
+    for (uint32_t y = 0; y < rows; y++) {
+        kmemcpy(dst, src, row_bytes);
+        dst += dst_pitch;
+        src += src_pitch;
+    }
+}
+
+static void nt_fill_rows(uint8_t* dst, uint32_t pitch, uint32_t width, uint32_t height,
+                         uint32_t value) {
+    kernel_fpu_begin();
+    for (uint32_t y = 0; y < height; y++) {
+        nt_fill32((uint32_t*)dst, value, width);
+        dst += pitch;
+    }
+    __asm__ volatile ("sfence" : : : "memory");
+    kernel_fpu_end();
+}
+
+static void nt_copy_rows(uint8_t* dst, uint32_t dst_pitch, const uint8_t* src,
+                         uint32_t src_pitch, uint32_t row_bytes, uint32_t rows) {
+    kernel_fpu_begin();
+    for (uint32_t y = 0; y < rows; y++) {
+        nt_copy(dst, src, row_bytes);
+        dst += dst_pitch;
+        src += src_pitch;
+    }
+    __asm__ volatile ("sfence" : : : "memory");
+    kernel_fpu_end();
+}
+
+static const stream_ops_t g_ops_cached = {cached_fill_rows, cached_copy_rows, "rep movs"};
+static const stream_ops_t g_ops_nt = {nt_fill_rows, nt_copy_rows, "sse2 movntdq"};
+static const stream_ops_t* g_ops = &g_ops_cached;
+
+void stream_init(void) {
+    g_ops = (fpu_features() & FPU_SSE2) ? &g_ops_nt : &g_ops_cached;
+}
+
+const char* stream_impl(void) {
+    return g_ops->name;
+}
+
+static const stream_ops_t* ops_for(size_t bytes) {
+    return bytes >= STREAM_NT_MIN ? g_ops : &g_ops_cached;
+}
+
+void stream_fill32(void* dst, uint32_t value, size_t count) {
+    ops_for(count * 4u)->fill_rows((uint8_t*)dst, 0, (uint32_t)count, 1, value);
+}
+
+void stream_copy(void* dst, const void* src, size_t n) {
+    ops_for(n)->copy_rows((uint8_t*)dst, 0, (const uint8_t*)src, 0, (uint32_t)n, 1);
+}
+
+void stream_fill_rect32(void* dst, uint32_t pitch, uint32_t width, uint32_t height,
+                        uint32_t value) {
+    ops_for((size_t)width * height * 4u)->fill_rows((uint8_t*)dst, pitch, width, height, value);
+}
+
+void stream_copy_rect(void* dst, uint32_t dst_pitch, const void* src, uint32_t src_pitch,
+                      uint32_t row_bytes, uint32_t rows) {
+    ops_for((size_t)row_bytes * rows)->copy_rows((uint8_t*)dst, dst_pitch, (const uint8_t*)src,
+                                                 src_pitch, row_bytes, rows);
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/* Writes at least this large go around the cache with movnti/movntdq when
+   SSE2 is enabled; smaller ones are likely to be read back soon and use
+   ordinary stores. */
+#define STREAM_NT_MIN (32u * 1024u)
+
+void        stream_init(void);
+const char* stream_impl(void);
+
+void stream_fill32(void* dst, uint32_t value, size_t count);
+void stream_copy(void* dst, const void* src, size_t n);
+void stream_fill_rect32(void* dst, uint32_t pitch, uint32_t width, uint32_t height,
+                        uint32_t value);
+void stream_copy_rect(void* dst, uint32_t dst_pitch, const void* src, uint32_t src_pitch,
+                      uint32_t row_bytes, uint32_t rows);
@@ -1,4 +1,11 @@
 #include "string.h"
+#include "../arch/i386/cpu.h"
+
+typedef struct {
+    void* (*copy)(void* dst, const void* src, size_t n);
+    void* (*set)(void* dst, int v, size_t n);
+    const char* name;
+} string_ops_t;
 
 size_t kstrlen(const char* s) {
     size_t n = 0;
@@ -14,19 +21,91 @@ int kstrcmp(const char* a, const char* b) {
     return (int)((unsigned char)*a) - (int)((unsigned char)*b);
 }
 
-void* kmemcpy(void* dst, const void* src, size_t n) {
+static void* memcpy_dword(void* dst, const void* src, size_t n) {
     uint8_t* d = (uint8_t*)dst;
     const uint8_t* s = (const uint8_t*)src;
-    for (size_t i = 0; i < n; i++) d[i] = s[i];
+    if (n >= 16) {
+        size_t head = (0u - (uintptr_t)d) & 3u;
+        size_t words = (n - head) >> 2;
+        n = (n - head) & 3u;
+        __asm__ volatile ("rep movsb" : "+D"(d), "+S"(s), "+c"(head) : : "memory");
+        __asm__ volatile ("rep movsl" : "+D"(d), "+S"(s), "+c"(words) : : "memory");
+    }
+    __asm__ volatile ("rep movsb" : "+D"(d), "+S"(s), "+c"(n) : : "memory");
     return dst;
 }
 
-void* kmemset(void* dst, int v, size_t n) {
+void* kmemmove(void* dst, const void* src, size_t n) {
     uint8_t* d = (uint8_t*)dst;
-    for (size_t i = 0; i < n; i++) d[i] = (uint8_t)v;
+    const uint8_t* s = (const uint8_t*)src;
+    if (d <= s || d >= s + n) return kmemcpy(dst, src, n);
+
+    /* Backward copy: DF must stay set across both moves and be cleared before the block ends. */
+    size_t tail = n & 3u;
+    d += n - 1u;
+    s += n - 1u;
+    __asm__ volatile (
+        "std\n\t"
+        "rep movsb\n\t"
+        "subl $3, %%edi\n\t"
+        "subl $3, %%esi\n\t"
+        "movl %3, %%ecx\n\t"
+        "rep movsl\n\t"
+        "cld"
+        : "+D"(d), "+S"(s), "+c"(tail)
+        : "r"(n >> 2)
+        : "cc", "memory");
+    return dst;
+}
+
+static void* memset_dword(void* dst, int v, size_t n) {
+    uint8_t* d = (uint8_t*)dst;
+    uint32_t fill = (uint8_t)v * 0x01010101u;
+    if (n >= 16) {
+        size_t head = (0u - (uintptr_t)d) & 3u;
+        size_t words = (n - head) >> 2;
+        n = (n - head) & 3u;
+        __asm__ volatile ("rep stosb" : "+D"(d), "+c"(head) : "a"(fill) : "memory");
+        __asm__ volatile ("rep stosl" : "+D"(d), "+c"(words) : "a"(fill) : "memory");
+    }
+    __asm__ volatile ("rep stosb" : "+D"(d), "+c"(n) : "a"(fill) : "memory");
+    return dst;
+}
+
+/* With ERMS, microcode picks the widest moves itself and plain rep movsb
+   beats the head/dword/tail split at every size. */
+static void* memcpy_erms(void* dst, const void* src, size_t n) {
+    void* d = dst;
+    __asm__ volatile ("rep movsb" : "+D"(d), "+S"(src), "+c"(n) : : "memory");
+    return dst;
+}
+
+static void* memset_erms(void* dst, int v, size_t n) {
+    void* d = dst;
+    __asm__ volatile ("rep stosb" : "+D"(d), "+c"(n) : "a"(v) : "memory");
     return dst;
 }
 
+static const string_ops_t g_ops_dword = {memcpy_dword, memset_dword, "rep movsl"};
+static const string_ops_t g_ops_erms = {memcpy_erms, memset_erms, "erms rep movsb"};
+static const string_ops_t* g_ops = &g_ops_dword;
+
+void string_init(void) {
+    g_ops = cpu_has(CPU_ERMS) ? &g_ops_erms : &g_ops_dword;
+}
+
+const char* string_impl(void) {
+    return g_ops->name;
+}
+
+void* kmemcpy(void* dst, const void* src, size_t n) {
+    return g_ops->copy(dst, src, n);
+}
+
+void* kmemset(void* dst, int v, size_t n) {
+    return g_ops->set(dst, v, n);
+}
+
 char* kstrncpy(char* dst, const char* src, size_t n) {
     if (n == 0) return dst;
     size_t i = 0;
@@ -0,0 +1,169 @@
+#include "frame.h"
+
+extern uint8_t _kernel_end[];
+
+static uint32_t frame_bitmap[FRAME_COUNT / 32u];
+static uint32_t frames_total = 0;
+static uint32_t frames_free = 0;
+static uint32_t next_hint = 0;
+static frame_reclaim_fn reclaimers[FRAME_RECLAIMERS];
+
+static int frame_used(uint32_t index)
+{
+    return (frame_bitmap[index / 32u] >> (index % 32u)) & 1u;
+}
+
+static void frame_set(uint32_t index, int used)
+{
+    if (used) frame_bitmap[index / 32u] |= 1u << (index % 32u);
+    else frame_bitmap[index / 32u] &= ~(1u << (index % 32u));
+}
+
+static void reserve_range(uint32_t base, uint32_t size)
+{
+    if (size == 0 || base >= FRAME_LIMIT) return;
+
+    uint32_t end = (size > FRAME_LIMIT - base) ? FRAME_LIMIT : base + size;
+    for (uint32_t index = base / FRAME_SIZE; index < (end + FRAME_SIZE - 1u) / FRAME_SIZE; index++) {
+        if (frame_used(index)) continue;
+        frame_set(index, 1);
+        frames_free--;
+        frames_total--;
+    }
+}
+
+void frame_init(const multiboot_info_t* mb)
+{
+    for (uint32_t i = 0; i < FRAME_COUNT / 32u; i++) {
+        frame_bitmap[i] = 0xFFFFFFFFu;
+    }
+    frames_total = 0;
+    frames_free = 0;
+    next_hint = 0;
+
+    if (!mb || (mb->flags & MB_INFO_MEMORY) == 0) return;
+
+    uint32_t top = FRAME_LIMIT;
+    if (mb->mem_upper < (FRAME_LIMIT - 0x100000u) / 1024u) {
+        top = 0x100000u + mb->mem_upper * 1024u;
+    }
+
+    uint32_t start = ((uint32_t)(uintptr_t)_kernel_end + FRAME_SIZE - 1u) & ~(FRAME_SIZE - 1u);
+    for (uint32_t addr = start; addr < top && top - addr >= FRAME_SIZE; addr += FRAME_SIZE) {
+        frame_set(addr / FRAME_SIZE, 0);
+        frames_free++;
+        frames_total++;
+    }
+
+    reserve_range((uint32_t)(uintptr_t)mb, sizeof(*mb));
+    if (mb->flags & MB_INFO_MODS) {
+        const multiboot_module_t* mods = (const multiboot_module_t*)(uintptr_t)mb->mods_addr;
+        reserve_range(mb->mods_addr, mb->mods_count * sizeof(multiboot_module_t));
+        for (uint32_t i = 0; i < mb->mods_count; i++) {
+            reserve_range(mods[i].mod_start, mods[i].mod_end - mods[i].mod_start);
+        }
+    }
+    if ((mb->flags & MB_INFO_FRAMEBUFFER) && mb->framebuffer_addr < FRAME_LIMIT) {
+        reserve_range((uint32_t)mb->framebuffer_addr, mb->framebuffer_pitch * mb->framebuffer_height);
+    }
+}
+
+static uint32_t run_reclaimers(uint32_t want)
+{
+    uint32_t got = 0;
+    for (uint32_t i = 0; i < FRAME_RECLAIMERS && got < want; i++) {
+        if (reclaimers[i]) got += reclaimers[i](want - got);
+    }
+    return got;
+}
+
+void* frame_alloc(void)
+{
+    if (frames_free == 0 && run_reclaimers(1) == 0) return 0;
+    if (frames_free == 0) return 0;
+
+    for (uint32_t n = 0; n < FRAME_COUNT; n++) {
+        uint32_t index = (next_hint + n) % FRAME_COUNT;
+        if (frame_bitmap[index / 32u] == 0xFFFFFFFFu) {
+            n += 31u - (index % 32u);
+            continue;
+        }
+        if (frame_used(index)) continue;
+
+        frame_set(index, 1);
+        frames_free--;
+        next_hint = index + 1u;
+        return (void*)(uintptr_t)(index * FRAME_SIZE);
+    }
+    return 0;
+}
+
+void frame_free(void* frame)
+{
+    uint32_t addr = (uint32_t)(uintptr_t)frame;
+    if ((addr & (FRAME_SIZE - 1u)) != 0 || addr >= FRAME_LIMIT) return;
+
+    uint32_t index = addr / FRAME_SIZE;
+    if (!frame_used(index)) return;
+    frame_set(index, 0);
+    frames_free++;
+    if (index < next_hint) next_hint = index;
+}
+
+/* Physically contiguous frames; first fit, one reclaim pass if nothing fits. */
+void* frame_alloc_run(uint32_t count)
+{
+    if (count == 0) return 0;
+
+    for (int pass = 0; pass < 2; pass++) {
+        uint32_t len = 0;
+        for (uint32_t index = 0; index < FRAME_COUNT; index++) {
+            if (index % 32u == 0 && frame_bitmap[index / 32u] == 0xFFFFFFFFu) {
+                len = 0;
+                index += 31u;
+                continue;
+            }
+            if (frame_used(index)) {
+                len = 0;
+                continue;
+            }
+            if (++len < count) continue;
+
+            uint32_t first = index + 1u - count;
+            for (uint32_t i = first; i <= index; i++) frame_set(i, 1);
+            frames_free -= count;
+            return (void*)(uintptr_t)(first * FRAME_SIZE);
+        }
+        if (pass == 0 && run_reclaimers(count) == 0) break;
+    }
+    return 0;
+}
+
+void frame_free_run(void* base, uint32_t count)
+{
+    uint32_t addr = (uint32_t)(uintptr_t)base;
+    for (uint32_t i = 0; i < count; i++) {
+        frame_free((void*)(uintptr_t)(addr + i * FRAME_SIZE));
+    }
+}
+
+int frame_register_reclaim(frame_reclaim_fn fn)
+{
+    for (uint32_t i = 0; i < FRAME_RECLAIMERS; i++) {
+        if (!reclaimers[i]) {
+            reclaimers[i] = fn;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+uint32_t frame_total(void)
+{
+    return frames_total;
+}
+
+uint32_t frame_free_count(void)
+{
+    return frames_free;
+}
@@ -0,0 +1,23 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+#include "../boot/multiboot.h"
+
+#define FRAME_SIZE       0x1000u
+#define FRAME_LIMIT      (64u << 20)
+#define FRAME_COUNT      (FRAME_LIMIT / FRAME_SIZE)
+#define FRAME_RECLAIMERS 4
+
+typedef uint32_t (*frame_reclaim_fn)(uint32_t want);
+
+void frame_init(const multiboot_info_t* mb);
+void* frame_alloc(void);
+void frame_free(void* frame);
+void* frame_alloc_run(uint32_t count);
+void frame_free_run(void* base, uint32_t count);
+int frame_register_reclaim(frame_reclaim_fn fn);
+uint32_t frame_total(void);
+uint32_t frame_free_count(void);
+
+#endif
@@ -1,11 +1,20 @@
 #include "paging.h"
+#include "../arch/i386/cpu.h"
 
 #define PAGE_PRESENT 0x1
 #define PAGE_RW      0x2
+#define PAGE_PWT     0x8
+#define PAGE_GLOBAL  0x100
 #define PAGE_TABLE_ENTRIES 1024
 #define LOW_IDENTITY_TABLES 16
 #define TOTAL_PAGE_TABLES 64
 
+#define CR4_PGE 0x80u
+#define MSR_PAT 0x277u
+/* Power-on PAT layout (WB, WT, UC-, UC) with entry 1 switched from WT to
+   WC, so a PTE with only PWT set maps write-combining memory. */
+#define PAT_WITH_WC 0x00070106u
+
 static uint32_t page_directory[PAGE_TABLE_ENTRIES] __attribute__((aligned(4096)));
 static uint32_t page_tables[TOTAL_PAGE_TABLES][PAGE_TABLE_ENTRIES] __attribute__((aligned(4096)));
 static uint32_t next_free_table = 0;
@@ -35,7 +44,7 @@ static uint32_t* ensure_page_table(uint32_t dir_index)
     return table;
 }
 
-static void map_identity_range(uint32_t base, uint32_t size)
+static void map_identity_range(uint32_t base, uint32_t size, uint32_t flags)
 {
     uint32_t start = base & 0xFFFFF000u;
     uint32_t end = (base + size + 0xFFFu) & 0xFFFFF000u;
@@ -48,12 +57,15 @@ static void map_identity_range(uint32_t base, uint32_t size)
         uint32_t table_index = (addr >> 12) & 0x3FFu;
         uint32_t* table = ensure_page_table(dir_index);
         if (!table) return;
-        table[table_index] = addr | PAGE_PRESENT | PAGE_RW;
+        table[table_index] = addr | PAGE_PRESENT | PAGE_RW | flags;
     }
 }
 
 void paging_init(uint32_t extra_identity_base, uint32_t extra_identity_size)
 {
+    uint32_t global = cpu_has(CPU_PGE) ? PAGE_GLOBAL : 0;
+    uint32_t extra_flags = 0;
+
     for (uint32_t i = 0; i < PAGE_TABLE_ENTRIES; i++) {
         page_directory[i] = 0;
     }
@@ -66,13 +78,17 @@ void paging_init(uint32_t extra_identity_base, uint32_t extra_identity_size)
 
         for (uint32_t i = 0; i < PAGE_TABLE_ENTRIES; i++) {
             uint32_t page = table * PAGE_TABLE_ENTRIES + i;
-            pt[i] = (page * 0x1000u) | PAGE_PRESENT | PAGE_RW;
+            pt[i] = (page * 0x1000u) | PAGE_PRESENT | PAGE_RW | global;
         }
 
         page_directory[table] = ((uint32_t)(uintptr_t)pt) | PAGE_PRESENT | PAGE_RW;
     }
 
-    map_identity_range(extra_identity_base, extra_identity_size);
+    if (cpu_has(CPU_PAT)) {
+        __asm__ __volatile__("wrmsr" :: "c"(MSR_PAT), "a"(PAT_WITH_WC), "d"(PAT_WITH_WC));
+        extra_flags = PAGE_PWT;
+    }
+    map_identity_range(extra_identity_base, extra_identity_size, extra_flags);
 
     __asm__ __volatile__("mov %0, %%cr3" :: "r"(page_directory));
 
@@ -80,4 +96,11 @@ void paging_init(uint32_t extra_identity_base, uint32_t extra_identity_size)
     __asm__ __volatile__("mov %%cr0, %0" : "=r"(cr0));
     cr0 |= 0x80000000;
     __asm__ __volatile__("mov %0, %%cr0" :: "r"(cr0));
+
+    if (global) {
+        uint32_t cr4;
+        __asm__ __volatile__("mov %%cr4, %0" : "=r"(cr4));
+        cr4 |= CR4_PGE;
+        __asm__ __volatile__("mov %0, %%cr4" :: "r"(cr4));
+    }
 }
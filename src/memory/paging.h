@@ -3,6 +3,8 @@
 
 #include <stdint.h>
 
+/* The extra range is the linear framebuffer; it is mapped write-combining
+   when the CPU has PAT. */
 void paging_init(uint32_t extra_identity_base, uint32_t extra_identity_size);
 
 #endif
@@ -4,9 +4,16 @@
 #include "debug/panic.h"
 #include "drivers/timer.h"
 #include "arch/i386/pic.h"
+#include "arch/i386/cpu.h"
 
 #include "fs/vfs.h"
+#include "fs/initrd.h"
+#include "fs/pcache.h"
+#include "fs/tmpfs.h"
+#include "memory/frame.h"
 #include "lib/string.h"
+#include "lib/crc32c.h"
+#include "lib/stream.h"
 #include "drivers/ata.h"
 #include "disk/mbr.h"
 #include "apps/donut.h"
@@ -35,14 +42,35 @@ static void cmd_help(const char* args) {
     vga_puts(
         "Commands:\n"
         "  parts\n"
-        "  mount <0-3>\n"
-        "  fatls\n"
-        "  fatcat <file>\n"
+        "  mount [<0-3> [name]]\n"
+        "  umount <name>\n"
+        "  fatls [vol:][path]\n"
+        "  fatcat [vol:]<path>\n"
+        "  fatcp [vol:]<src> [vol:]<dst>\n"
+        "  fatstat [vol]\n"
+        "  fatdefrag [vol:][file|all]\n"
+        "  fatdefragcheck [vol:]<file>  (appends 4 KiB)\n"
+        "  fattouch <path>\n"
+        "  fatwrite <path> <text>\n"
+        "  fatappend <path> <text>\n"
+        "  fattrunc <path> <size>\n"
+        "  fatrm <path>\n"
         "  explorer\n"
         "  donut [blocks|dots|char|scan]\n"
         "  minesweeper\n"
         "  mbr\n"
         "  cat <file>\n"
+        "  sum <file>\n"
+        "  initrdcheck\n"
+        "  membench\n"
+        "  cpuinfo\n"
+        "  pcstat\n"
+        "  sync\n"
+        "  touch <path>\n"
+        "  mkdir <path>\n"
+        "  write <path> <text>\n"
+        "  rm <path>\n"
+        "  df\n"
         "  clear\n"
         "  diskinfo\n"
         "  div0\n"
@@ -50,7 +78,7 @@ static void cmd_help(const char* args) {
         "  help\n"
         "  hexdump\n"
         "  int3\n"
-        "  ls\n"
+        "  ls [path]\n"
         "  masks\n"
         "  panic\n"
         "  ticks\n" 
@@ -90,9 +118,52 @@ static void cmd_masks(const char* args) {
     vga_putc('\n');
 }
 
+static void list_dir(const char* cmd, const char* path) {
+    int fd = vfs_opendir(path);
+    if (fd < 0) {
+        vfs_stat_t st;
+        if (vfs_stat(path, &st) != 0 || st.type != VFS_NODE_FILE) {
+            vga_puts(cmd);
+            vga_puts(": cannot open ");
+            vga_puts(path);
+            vga_putc('\n');
+            return;
+        }
+        vga_puts(path);
+        vga_puts("  ");
+        kprint_dec(st.size);
+        vga_puts(" bytes\n");
+        return;
+    }
+
+    vfs_dirent_t ents[16];
+    uint32_t total = 0;
+    int32_t got;
+    while ((got = vfs_readdir(fd, ents, 16)) > 0) {
+        for (int32_t i = 0; i < got; i++) {
+            vga_puts(ents[i].name);
+            if (ents[i].type == VFS_NODE_DIR) {
+                vga_puts("  <DIR>\n");
+                continue;
+            }
+            vga_puts("  ");
+            kprint_dec(ents[i].size);
+            vga_puts(" bytes\n");
+        }
+        total += (uint32_t)got;
+    }
+    vfs_closedir(fd);
+    if (got < 0) {
+        vga_puts(cmd);
+        vga_puts(": read error\n");
+    } else if (total == 0) {
+        vga_puts("(empty)\n");
+    }
+}
+
 static void cmd_ls(const char* args) {
-    (void)args;
-    vfs_list();
+    args = skip_spaces(args);
+    list_dir("ls", *args ? args : ".");
 }
 
 static void cmd_cat(const char* args) {
@@ -102,31 +173,72 @@ static void cmd_cat(const char* args) {
         return;
     }
 
-    char name[32];
+    char name[128];
     unsigned i = 0;
     while (*args && *args != ' ' && *args != '\t' && i < (sizeof(name) - 1)) {
         name[i++] = *args++;
     }
     name[i] = '\0';
 
-    vfs_node_t* n = vfs_open(name);
-    if (!n) {
+    int fd = vfs_fd_open(name);
+    if (fd < 0) {
         vga_puts("cat: not found: ");
         vga_puts(name);
         vga_putc('\n');
         return;
     }
 
-    uint8_t buf[256];
-    size_t off = 0;
-    while (off < n->size) {
-        size_t got = vfs_read(n, off, sizeof(buf), buf);
-        if (got == 0) break;
-        for (size_t j = 0; j < got; j++) vga_putc((char)buf[j]);
-        off += got;
+    const uint8_t* data;
+    uint32_t total = 0;
+    if (vfs_fd_map(fd, &data, &total) == 0) {
+        vga_write((const char*)data, total);
+    } else {
+        vfs_fd_advise(fd, VFS_ADVICE_SEQUENTIAL);
+
+        uint8_t buf[256];
+        int32_t got;
+        while ((got = vfs_fd_read(fd, buf, sizeof(buf))) > 0) {
+            vga_write((const char*)buf, (size_t)got);
+            total += (uint32_t)got;
+        }
     }
-    if (n->size == 0) vga_puts("(empty)");
+    if (total == 0) vga_puts("(empty)");
+    vga_putc('\n');
+    vfs_fd_close(fd);
+}
+
+static void cmd_pcstat(const char* args) {
+    (void)args;
+    pcache_stats_t s;
+    pcache_get_stats(&s);
+
+    vga_puts("frames: ");
+    kprint_dec(frame_free_count());
+    vga_putc('/');
+    kprint_dec(frame_total());
+    vga_puts(" free\n");
+    vga_puts("page cache: ");
+    kprint_dec(s.pages);
+    vga_puts(" pages, ");
+    kprint_dec(s.dirty);
+    vga_puts(" dirty\n");
+    vga_puts("  hits: ");
+    kprint_dec(s.hits);
+    vga_puts(", misses: ");
+    kprint_dec(s.misses);
+    vga_puts(", uncached: ");
+    kprint_dec(s.bypass);
     vga_putc('\n');
+    vga_puts("  evictions: ");
+    kprint_dec(s.evictions);
+    vga_puts(", writebacks: ");
+    kprint_dec(s.writebacks);
+    vga_putc('\n');
+}
+
+static void cmd_sync(const char* args) {
+    (void)args;
+    if (vfs_sync() < 0) vga_puts("sync: write-back failed\n");
 }
 
 static void cmd_int3(const char* args) {
@@ -172,23 +284,23 @@ static uint32_t parse_u32(const char* s, int* ok) {
 }
 
 static void hexdump_line(uint32_t base_off, const uint8_t* p, size_t n) {
-    kprint_hex32(base_off);
-    vga_puts(": ");
+    char line[96];
+    int len = ksnprintf(line, sizeof(line), "0x%08X: ", base_off);
+
     for (size_t i = 0; i < 16; i++) {
-        if (i < n) {
-            kprint_hex8(p[i]);
-            vga_putc(' ');
-        } else {
-            vga_puts("   ");
-        }
+        if (i < n) len += ksnprintf(line + len, sizeof(line) - len, "%02X ", p[i]);
+        else len += ksnprintf(line + len, sizeof(line) - len, "   ");
     }
-    vga_puts(" |");
+    line[len++] = ' ';
+    line[len++] = '|';
     for (size_t i = 0; i < n; i++) {
         char c = (char)p[i];
         if (c < 32 || c > 126) c = '.';
-        vga_putc(c);
+        line[len++] = c;
     }
-    vga_puts("|\n");
+    line[len++] = '|';
+    line[len++] = '\n';
+    vga_write(line, (size_t)len);
 }
 
 static void cmd_hexdump(const char* args) {
@@ -240,40 +352,22 @@ static void cmd_mbr(const char* args) {
 
     const mbr_t* mbr = (const mbr_t*)sector;
 
-    vga_puts("MBR signature: ");
     if (!mbr_is_valid(mbr)) {
-        vga_puts("INVALID (expected 0x55AA)\n");
+        vga_puts("MBR signature: INVALID (expected 0x55AA)\n");
         return;
     }
-    vga_puts("OK (0x55AA)\n");
+    vga_puts("MBR signature: OK (0x55AA)\n");
 
     for (int i = 0; i < MBR_PARTITION_COUNT; i++) {
         const mbr_partition_t* p = &mbr->part[i];
 
         if (p->type == 0 || p->lba_count == 0) {
-            vga_puts("Partition ");
-            kprint_dec(i);
-            vga_puts(": <empty>\n");
+            kprintf("Partition %d: <empty>\n", i);
             continue;
         }
 
-        vga_puts("Partition ");
-        kprint_dec(i);
-        vga_puts(": ");
-
-        vga_puts("boot=");
-        vga_puts((p->status == 0x80) ? "yes" : "no");
-
-        vga_puts(" type=0x");
-        kprint_hex8(p->type);
-
-        vga_puts(" start=");
-        kprint_dec(p->lba_start);
-
-        vga_puts(" count=");
-        kprint_dec(p->lba_count);
-
-        vga_putc('\n');
+        kprintf("Partition %d: boot=%s type=0x%02X start=%u count=%u\n", i,
+                (p->status == 0x80) ? "yes" : "no", p->type, p->lba_start, p->lba_count);
     }
 }
 
@@ -318,63 +412,640 @@ static void cmd_parts(const char* args) {
     }
 
     for (int i = 0; i < 4; i++) {
-        vga_puts("part ");
-        kprint_dec(i);
-        vga_puts(": ");
-
         if (!p[i].present) {
-            vga_puts("<empty>\n");
+            kprintf("part %d: <empty>\n", i);
             continue;
         }
 
-        vga_puts("boot=");
-        vga_puts(p[i].bootable ? "yes" : "no");
-        vga_puts(" type=0x");
-        kprint_hex8(p[i].type);
-        vga_puts(" start=");
-        kprint_dec(p[i].lba_start);
-        vga_puts(" count=");
-        kprint_dec(p[i].lba_count);
+        kprintf("part %d: boot=%s type=0x%02X start=%u count=%u\n", i,
+                p[i].bootable ? "yes" : "no", p[i].type, p[i].lba_start, p[i].lba_count);
+    }
+}
+
+static fat16_volume_t* g_fat_cur;
+
+static const char* next_token(const char* s, char* out, unsigned max) {
+    unsigned i = 0;
+    s = skip_spaces(s);
+    while (*s && *s != ' ' && *s != '\t') {
+        if (i + 1 < max) out[i++] = *s;
+        s++;
+    }
+    out[i] = '\0';
+    return skip_spaces(s);
+}
+
+static fat16_volume_t* fat_path(const char* arg, const char** path) {
+    for (const char* p = arg; *p && *p != '/'; p++) {
+        if (*p != ':') continue;
+
+        char name[FAT16_NAME_MAX];
+        unsigned n = 0;
+        while (arg + n < p && n + 1 < sizeof(name)) {
+            name[n] = arg[n];
+            n++;
+        }
+        name[n] = '\0';
+        *path = p + 1;
+        return fat16_find(name);
+    }
+    *path = arg;
+    return g_fat_cur;
+}
+
+static void mount_list(void) {
+    int any = 0;
+    for (uint32_t i = 0; i < FAT16_MAX_VOLUMES; i++) {
+        fat16_volume_t* v = fat16_volume_at(i);
+        if (!v) continue;
+        any = 1;
+        vga_puts(v == g_fat_cur ? "* " : "  ");
+        vga_puts(fat16_name(v));
+        vga_puts("  ");
+        vga_puts(fat16_type_name(v));
+        vga_puts("  lba ");
+        kprint_dec(fat16_part_lba(v));
+        vga_puts("  " FAT16_VFS_PREFIX);
+        vga_puts(fat16_name(v));
         vga_putc('\n');
     }
+    if (!any) vga_puts("(no volumes mounted)\n");
 }
 
 static void cmd_mount(const char* args) {
+    args = skip_spaces(args);
+    if (!*args) {
+        mount_list();
+        return;
+    }
+
+    char num[8];
+    const char* rest = next_token(args, num, sizeof(num));
     int ok = 0;
-    uint32_t idx = parse_u32(args, &ok);
+    uint32_t idx = parse_u32(num, &ok);
     if (!ok || idx > 3) {
-        vga_puts("usage: mount <0-3>\n");
+        vga_puts("usage: mount [<0-3> [name]]\n");
         return;
     }
 
+    char name[FAT16_NAME_MAX];
+    next_token(rest, name, sizeof(name));
+    if (!name[0]) {
+        kstrncpy(name, "fat0", sizeof(name));
+        name[3] = (char)('0' + idx);
+    }
+
     part_info_t p;
     if (part_get((int)idx, &p) != 0) {
         vga_puts("mount: partition not present\n");
         return;
     }
 
-    if (fat16_mount(p.lba_start) != 0) {
-        vga_puts("mount: not FAT16 (or mount failed)\n");
+    fat16_volume_t* v = fat16_mount(p.lba_start, name);
+    if (!v) {
+        vga_puts("mount: not FAT16/FAT32 (or mount failed)\n");
         return;
     }
+    g_fat_cur = v;
 
-    vga_puts("mount: FAT16 mounted on part ");
+    vga_puts("mount: ");
+    vga_puts(fat16_type_name(v));
+    vga_puts(" on part ");
     kprint_dec((uint32_t)idx);
+    vga_puts(" mounted as ");
+    vga_puts(name);
     vga_putc('\n');
 }
 
+static void cmd_umount(const char* args) {
+    char name[FAT16_NAME_MAX];
+    next_token(args, name, sizeof(name));
+    fat16_volume_t* v = fat16_find(name);
+    if (!v) {
+        vga_puts("usage: umount <name>\n");
+        return;
+    }
+
+    if (fat16_unmount(v) != 0) vga_puts("umount: flush failed\n");
+
+    if (g_fat_cur == v) {
+        g_fat_cur = 0;
+        for (uint32_t i = 0; i < FAT16_MAX_VOLUMES && !g_fat_cur; i++) g_fat_cur = fat16_volume_at(i);
+    }
+}
+
+static void fat_list(fat16_volume_t* v, const char* path) {
+    const char* root = fat16_mount_path(v);
+    if (!root) {
+        vga_puts("fatls: not mounted (use: mount <0-3> [name])\n");
+        return;
+    }
+
+    char full[VFS_MOUNT_PATH + 128];
+    uint32_t n = (uint32_t)kstrlen(root);
+    kmemcpy(full, root, n);
+    full[n++] = '/';
+    kstrncpy(full + n, path, sizeof(full) - n - 1u);
+    full[sizeof(full) - 1u] = '\0';
+    list_dir("fatls", full);
+}
+
 static void cmd_fatls(const char* args) {
-    (void)args;
-    fat16_ls_root();
+    char arg[128];
+    next_token(args, arg, sizeof(arg));
+    const char* path;
+    fat16_volume_t* v = fat_path(arg, &path);
+    fat_list(v, path);
 }
 
 static void cmd_fatcat(const char* args) {
     args = skip_spaces(args);
     if (!*args) {
-        vga_puts("usage: fatcat <FILE.TXT>\n");
-        return;
-    }
-    fat16_cat(args);
+        vga_puts("usage: fatcat [vol:]<path>\n");
+        return;
+    }
+    const char* path;
+    fat16_volume_t* v = fat_path(args, &path);
+    fat16_cat(v, path);
+}
+
+static void cmd_fattouch(const char* args) {
+    char path[128];
+    next_token(args, path, sizeof(path));
+    if (!path[0]) {
+        vga_puts("usage: fattouch <path>\n");
+        return;
+    }
+    const char* p;
+    fat16_volume_t* v = fat_path(path, &p);
+    if (fat16_create(v, p) != 0) {
+        vga_puts("fattouch: create failed (exists, bad name, or directory full)\n");
+    }
+}
+
+static void fat_put_text(const char* cmd, const char* args, int append) {
+    char path[128];
+    const char* text = next_token(args, path, sizeof(path));
+    if (!path[0]) {
+        vga_puts("usage: ");
+        vga_puts(cmd);
+        vga_puts(" <path> <text>\n");
+        return;
+    }
+
+    const char* p;
+    fat16_volume_t* v = fat_path(path, &p);
+
+    if (!append) {
+        fat16_create(v, p);
+        if (fat16_truncate(v, p, 0) != 0) {
+            vga_puts(cmd);
+            vga_puts(": cannot open ");
+            vga_puts(path);
+            vga_putc('\n');
+            return;
+        }
+    }
+
+    uint32_t len = (uint32_t)kstrlen(text);
+    if ((len > 0 && fat16_append(v, p, text, len) != (int32_t)len) ||
+        fat16_append(v, p, "\n", 1) != 1) {
+        vga_puts(cmd);
+        vga_puts(": write failed\n");
+    }
+}
+
+static void cmd_fatwrite(const char* args) {
+    fat_put_text("fatwrite", args, 0);
+}
+
+static void cmd_fatappend(const char* args) {
+    fat_put_text("fatappend", args, 1);
+}
+
+static void cmd_fattrunc(const char* args) {
+    char path[128];
+    const char* rest = next_token(args, path, sizeof(path));
+    int ok = 0;
+    uint32_t size = parse_u32(rest, &ok);
+    if (!path[0] || !ok) {
+        vga_puts("usage: fattrunc <path> <size>\n");
+        return;
+    }
+    const char* p;
+    fat16_volume_t* v = fat_path(path, &p);
+    if (fat16_truncate(v, p, size) != 0) {
+        vga_puts("fattrunc: failed\n");
+    }
+}
+
+static void cmd_fatrm(const char* args) {
+    char path[128];
+    next_token(args, path, sizeof(path));
+    if (!path[0]) {
+        vga_puts("usage: fatrm <path>\n");
+        return;
+    }
+    const char* p;
+    fat16_volume_t* v = fat_path(path, &p);
+    if (fat16_delete(v, p) != 0) {
+        vga_puts("fatrm: cannot remove ");
+        vga_puts(path);
+        vga_putc('\n');
+    }
+}
+
+static uint8_t g_fat_copy_buf[16384];
+
+static void cmd_fatcp(const char* args) {
+    char src[128];
+    char dst[128];
+    next_token(next_token(args, src, sizeof(src)), dst, sizeof(dst));
+    if (!src[0] || !dst[0]) {
+        vga_puts("usage: fatcp [vol:]<src> [vol:]<dst>\n");
+        return;
+    }
+
+    const char* sp;
+    const char* dp;
+    fat16_volume_t* sv = fat_path(src, &sp);
+    fat16_volume_t* dv = fat_path(dst, &dp);
+    if (!sv || !dv) {
+        vga_puts("fatcp: no such volume\n");
+        return;
+    }
+    if (sv == dv && kstrcmp(sp, dp) == 0) {
+        vga_puts("fatcp: source and destination are the same\n");
+        return;
+    }
+
+    if (fat16_read(sv, sp, 0, g_fat_copy_buf, 0) < 0) {
+        vga_puts("fatcp: cannot open ");
+        vga_puts(src);
+        vga_putc('\n');
+        return;
+    }
+
+    fat16_create(dv, dp);
+    if (fat16_truncate(dv, dp, 0) != 0) {
+        vga_puts("fatcp: cannot open ");
+        vga_puts(dst);
+        vga_putc('\n');
+        return;
+    }
+
+    uint32_t off = 0;
+    for (;;) {
+        int32_t got = fat16_read(sv, sp, off, g_fat_copy_buf, sizeof(g_fat_copy_buf));
+        if (got < 0) {
+            vga_puts("fatcp: read failed\n");
+            return;
+        }
+        if (got == 0) break;
+        if (fat16_append(dv, dp, g_fat_copy_buf, (uint32_t)got) != got) {
+            vga_puts("fatcp: write failed\n");
+            return;
+        }
+        off += (uint32_t)got;
+    }
+
+    kprint_dec(off);
+    vga_puts(" bytes copied\n");
+}
+
+static void cmd_fatdefrag(const char* args) {
+    char arg[128];
+    next_token(args, arg, sizeof(arg));
+    const char* path;
+    fat16_volume_t* v = fat_path(arg, &path);
+
+    if (!*path) fat16_defrag(v, 0, 0);
+    else if (kstrcmp(path, "all") == 0) fat16_defrag(v, 0, 1);
+    else fat16_defrag(v, path, 1);
+}
+
+static uint8_t g_sum_buf[16384];
+
+static void cmd_sum(const char* args) {
+    char path[128];
+    next_token(args, path, sizeof(path));
+    if (!path[0]) {
+        vga_puts("usage: sum <file>\n");
+        return;
+    }
+
+    int fd = vfs_fd_open(path);
+    if (fd < 0) {
+        vga_puts("sum: not found: ");
+        vga_puts(path);
+        vga_putc('\n');
+        return;
+    }
+
+    uint64_t start = timer_cycles();
+    uint32_t crc = 0;
+    uint32_t total = 0;
+    const uint8_t* data;
+    if (vfs_fd_map(fd, &data, &total) == 0) {
+        crc = crc32c(0, data, total);
+    } else {
+        vfs_fd_advise(fd, VFS_ADVICE_SEQUENTIAL);
+        int32_t got;
+        while ((got = vfs_fd_read(fd, g_sum_buf, sizeof(g_sum_buf))) > 0) {
+            crc = crc32c(crc, g_sum_buf, (uint32_t)got);
+            total += (uint32_t)got;
+        }
+    }
+    uint32_t us = timer_us_since(start);
+    vfs_fd_close(fd);
+
+    kprint_hex32(crc);
+    vga_puts("  ");
+    kprint_dec(total);
+    vga_puts(" bytes  ");
+    kprint_dec(us);
+    vga_puts(" us");
+    if (us > 0) {
+        vga_puts("  ");
+        kprint_dec(total / us);
+        vga_puts(" MB/s");
+    }
+    vga_puts(" (");
+    vga_puts(crc32c_impl());
+    vga_puts(")\n");
+}
+
+#define BENCH_FRAMES ((1024u * 1024u) / FRAME_SIZE)
+
+static uint8_t* g_bench_src;
+static uint8_t* g_bench_dst;
+
+static void loop_copy(void* dst, const void* src, size_t n) {
+    uint8_t* d = (uint8_t*)dst;
+    const uint8_t* s = (const uint8_t*)src;
+    for (size_t i = 0; i < n; i++) d[i] = s[i];
+}
+
+static void loop_set(void* dst, int v, size_t n) {
+    uint8_t* d = (uint8_t*)dst;
+    for (size_t i = 0; i < n; i++) d[i] = (uint8_t)v;
+}
+
+static uint32_t bench_mbps(int op, int fast, uint32_t size) {
+    uint32_t reps = (16u * 1024u * 1024u) / size;
+    uint64_t start = timer_cycles();
+    for (uint32_t r = 0; r < reps; r++) {
+        if (op == 0 && fast) kmemcpy(g_bench_dst, g_bench_src, size);
+        else if (op == 0) loop_copy(g_bench_dst, g_bench_src, size);
+        else if (fast) kmemset(g_bench_dst, (int)r, size);
+        else loop_set(g_bench_dst, (int)r, size);
+    }
+    uint32_t us = timer_us_since(start);
+    return us ? (reps * size) / us : 0;
+}
+
+static void cmd_initrdcheck(const char* args) {
+    (void)args;
+    int bad = initrd_verify();
+    if (bad < 0) {
+        vga_puts("initrdcheck: initrd has no checksums\n");
+        return;
+    }
+    if (bad == 0) {
+        vga_puts("initrd: all entries ok\n");
+        return;
+    }
+    kprint_dec((uint32_t)bad);
+    vga_puts(" bad entries\n");
+}
+
+/* Defragments the whole volume while the file is open with unsynced appended data. */
+static void cmd_fatdefragcheck(const char* args) {
+    char arg[128];
+    next_token(args, arg, sizeof(arg));
+    const char* path;
+    fat16_volume_t* v = fat_path(arg, &path);
+    if (!v || !fat16_mount_path(v) || !*path) {
+        vga_puts("usage: fatdefragcheck [vol:]<file>\n");
+        return;
+    }
+
+    char full[192];
+    kstrncpy(full, fat16_mount_path(v), sizeof(full));
+    uint32_t n = (uint32_t)kstrlen(full);
+    if (*path != '/' && n + 1u < sizeof(full)) full[n++] = '/';
+    kstrncpy(full + n, path, sizeof(full) - n);
+    full[sizeof(full) - 1] = '\0';
+
+    int fd = vfs_fd_open(full);
+    if (fd < 0) {
+        vga_puts("fatdefragcheck: not found: ");
+        vga_puts(full);
+        vga_putc('\n');
+        return;
+    }
+
+    uint32_t crc = 0;
+    uint32_t size = 0;
+    int32_t got;
+    while ((got = vfs_fd_read(fd, g_sum_buf, sizeof(g_sum_buf))) > 0) {
+        crc = crc32c(crc, g_sum_buf, (uint32_t)got);
+        size += (uint32_t)got;
+    }
+
+    for (uint32_t i = 0; i < 4096u; i++) g_sum_buf[i] = (uint8_t)(i * 7u + size);
+    if (vfs_fd_write(fd, g_sum_buf, 4096u) != 4096) {
+        vga_puts("fatdefragcheck: write failed\n");
+        vfs_fd_close(fd);
+        return;
+    }
+    crc = crc32c(crc, g_sum_buf, 4096u);
+    size += 4096u;
+
+    fat16_defrag(v, 0, 1);
+    vfs_fd_close(fd);
+
+    uint32_t crc2 = 0;
+    uint32_t off = 0;
+    while ((got = fat16_read(v, path, off, g_sum_buf, sizeof(g_sum_buf))) > 0) {
+        crc2 = crc32c(crc2, g_sum_buf, (uint32_t)got);
+        off += (uint32_t)got;
+    }
+
+    vga_puts((crc2 == crc && off == size) ? "fatdefragcheck: ok, " : "fatdefragcheck: MISMATCH, ");
+    kprint_dec(off);
+    vga_putc('/');
+    kprint_dec(size);
+    vga_puts(" bytes\n");
+}
+
+static void cmd_membench(const char* args) {
+    (void)args;
+    static const uint32_t sizes[] = { 64u, 4096u, 1024u * 1024u };
+    static const char* const ops[] = { "memcpy", "memset" };
+
+    g_bench_src = (uint8_t*)frame_alloc_run(BENCH_FRAMES);
+    g_bench_dst = (uint8_t*)frame_alloc_run(BENCH_FRAMES);
+    if (!g_bench_src || !g_bench_dst) {
+        if (g_bench_src) frame_free_run(g_bench_src, BENCH_FRAMES);
+        if (g_bench_dst) frame_free_run(g_bench_dst, BENCH_FRAMES);
+        vga_puts("membench: not enough contiguous memory\n");
+        return;
+    }
+
+    vga_puts("op      size     loop MB/s  rep MB/s\n");
+    for (int op = 0; op < 2; op++) {
+        for (uint32_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            vga_puts(ops[op]);
+            vga_puts("  ");
+            kprint_dec(sizes[i] >= 1024u ? sizes[i] / 1024u : sizes[i]);
+            vga_puts(sizes[i] >= 1024u ? " KiB" : " B");
+            vga_puts("   ");
+            kprint_dec(bench_mbps(op, 0, sizes[i]));
+            vga_puts("   ");
+            kprint_dec(bench_mbps(op, 1, sizes[i]));
+            vga_putc('\n');
+        }
+    }
+
+    frame_free_run(g_bench_src, BENCH_FRAMES);
+    frame_free_run(g_bench_dst, BENCH_FRAMES);
+}
+
+static void cmd_cpuinfo(const char* args) {
+    (void)args;
+    static const struct { uint32_t flag; const char* name; } flags[] = {
+        {CPU_FPU, "fpu"}, {CPU_PSE, "pse"}, {CPU_TSC, "tsc"}, {CPU_APIC, "apic"},
+        {CPU_PGE, "pge"}, {CPU_PAT, "pat"}, {CPU_FXSR, "fxsr"}, {CPU_SSE, "sse"},
+        {CPU_SSE2, "sse2"}, {CPU_SSE42, "sse4.2"}, {CPU_ERMS, "erms"}, {CPU_TSC_INV, "invtsc"},
+    };
+    const cpu_info_t* cpu = cpu_info();
+
+    if (!cpu->vendor[0]) {
+        vga_puts("cpuinfo: no CPUID\n");
+    } else {
+        const char* brand = skip_spaces(cpu->brand);
+        vga_puts("vendor    ");
+        vga_puts(cpu->vendor);
+        vga_putc('\n');
+        if (*brand) {
+            vga_puts("model     ");
+            vga_puts(brand);
+            vga_putc('\n');
+        }
+        vga_puts("family    ");
+        kprint_dec(cpu->family);
+        vga_puts("  model ");
+        kprint_dec(cpu->model);
+        vga_puts("  stepping ");
+        kprint_dec(cpu->stepping);
+        vga_puts("\ncacheline ");
+        kprint_dec(cpu->cache_line);
+        vga_puts(" B\nflags    ");
+        for (uint32_t i = 0; i < sizeof(flags) / sizeof(flags[0]); i++) {
+            if (!cpu_has(flags[i].flag)) continue;
+            vga_putc(' ');
+            vga_puts(flags[i].name);
+        }
+        vga_putc('\n');
+    }
+
+    vga_puts("memcpy    ");
+    vga_puts(string_impl());
+    vga_puts("\nmemset    ");
+    vga_puts(string_impl());
+    vga_puts("\nchecksum  ");
+    vga_puts(crc32c_impl());
+    vga_puts("\nblit      ");
+    vga_puts(stream_impl());
+    vga_putc('\n');
+}
+
+static void cmd_touch(const char* args) {
+    char path[128];
+    next_token(args, path, sizeof(path));
+    if (!path[0]) {
+        vga_puts("usage: touch <path>\n");
+        return;
+    }
+    vfs_node_t* node = vfs_create(path, VFS_NODE_FILE);
+    if (!node) {
+        vga_puts("touch: cannot create ");
+        vga_puts(path);
+        vga_putc('\n');
+        return;
+    }
+    vfs_close(node);
+}
+
+static void cmd_mkdir(const char* args) {
+    char path[128];
+    next_token(args, path, sizeof(path));
+    if (!path[0]) {
+        vga_puts("usage: mkdir <path>\n");
+        return;
+    }
+    if (!vfs_create(path, VFS_NODE_DIR)) {
+        vga_puts("mkdir: cannot create ");
+        vga_puts(path);
+        vga_putc('\n');
+    }
+}
+
+static void cmd_write(const char* args) {
+    char path[128];
+    const char* text = next_token(args, path, sizeof(path));
+    if (!path[0]) {
+        vga_puts("usage: write <path> <text>\n");
+        return;
+    }
+
+    vfs_unlink(path);
+    vfs_node_t* node = vfs_create(path, VFS_NODE_FILE);
+    if (!node) {
+        vga_puts("write: cannot create ");
+        vga_puts(path);
+        vga_putc('\n');
+        return;
+    }
+
+    uint32_t len = (uint32_t)kstrlen(text);
+    if (vfs_write(node, 0, len, (const uint8_t*)text) != len ||
+        vfs_write(node, len, 1, (const uint8_t*)"\n") != 1) {
+        vga_puts("write: write failed\n");
+    }
+    vfs_close(node);
+}
+
+static void cmd_rm(const char* args) {
+    char path[128];
+    next_token(args, path, sizeof(path));
+    if (!path[0]) {
+        vga_puts("usage: rm <path>\n");
+        return;
+    }
+    if (vfs_unlink(path) != 0) {
+        vga_puts("rm: cannot remove ");
+        vga_puts(path);
+        vga_putc('\n');
+    }
+}
+
+static void cmd_df(const char* args) {
+    (void)args;
+    uint32_t files, pages;
+    tmpfs_usage(&files, &pages);
+    vga_puts(TMPFS_MOUNT_PATH ": ");
+    kprint_dec(files);
+    vga_puts(" files, ");
+    kprint_dec(pages * 4u);
+    vga_puts(" KiB\n");
+}
+
+static void cmd_fatstat(const char* args) {
+    char name[FAT16_NAME_MAX];
+    next_token(args, name, sizeof(name));
+    fat16_print_stats(name[0] ? fat16_find(name) : g_fat_cur);
 }
 
 static void cmd_explorer(const char* args) {
@@ -388,9 +1059,9 @@ static void cmd_explorer(const char* args) {
     vga_puts("  window manager: not implemented yet\n");
     vga_puts("  mouse/pointer: PS/2 pointer active\n");
     vga_puts("\nInitrd explorer:\n");
-    vfs_list();
+    list_dir("explorer", INITRD_MOUNT_PATH);
     vga_puts("\nFAT16 explorer:\n");
-    fat16_ls_root();
+    fat_list(g_fat_cur, "/");
 }
 
 struct command {
@@ -401,8 +1072,18 @@ struct command {
 static const struct command commands[] = {
     {"parts", cmd_parts},
 {"mount", cmd_mount},
+    {"umount", cmd_umount},
     {"fatls", cmd_fatls},
 {"fatcat", cmd_fatcat},
+    {"fatcp", cmd_fatcp},
+    {"fatstat", cmd_fatstat},
+    {"fatdefrag", cmd_fatdefrag},
+    {"fatdefragcheck", cmd_fatdefragcheck},
+    {"fattouch", cmd_fattouch},
+    {"fatwrite", cmd_fatwrite},
+    {"fatappend", cmd_fatappend},
+    {"fattrunc", cmd_fattrunc},
+    {"fatrm", cmd_fatrm},
     {"explorer", cmd_explorer},
     {"donut", cmd_donut},
     {"minesweeper", cmd_minesweeper},
@@ -415,6 +1096,17 @@ static const struct command commands[] = {
     {"masks", cmd_masks},
     {"ls",    cmd_ls},
     {"cat",   cmd_cat},
+    {"sum",   cmd_sum},
+    {"initrdcheck", cmd_initrdcheck},
+    {"membench", cmd_membench},
+    {"cpuinfo", cmd_cpuinfo},
+    {"pcstat", cmd_pcstat},
+    {"sync",  cmd_sync},
+    {"touch", cmd_touch},
+    {"mkdir", cmd_mkdir},
+    {"write", cmd_write},
+    {"rm",    cmd_rm},
+    {"df",    cmd_df},
     {"int3",  cmd_int3},
     {"div0",  cmd_div0},
     {"panic", cmd_panic},
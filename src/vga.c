@@ -3,6 +3,8 @@
 #include <stdint.h>
 
 #include "boot/multiboot.h"
+#include "lib/stream.h"
+#include "lib/string.h"
 
 #define VGA_TEXT_BUFFER ((volatile uint16_t*)0xB8000)
 #define VGA_TEXT_COLS 80
@@ -41,12 +43,15 @@ static uint32_t g_fb_height = 0;
 static uint8_t g_fb_bpp = 0;
 static int g_desktop_enabled = 0;
 static int g_fb_batch = 0;
+static int g_write_depth = 0;
+static int g_redraw_pending = 0;
 static int g_mouse_visible = 0;
 static uint16_t g_mouse_x = 0;
 static uint16_t g_mouse_y = 0;
 static uint32_t g_mouse_saved[FB_CURSOR_W * FB_CURSOR_H];
 static uint16_t g_mouse_saved_w = 0;
 static uint16_t g_mouse_saved_h = 0;
+static uint32_t g_fb_band[FB_CELL_H * VGA_MAX_COLS * FB_CELL_W];
 
 static const uint16_t mouse_shape[FB_CURSOR_H] = {
     0x800, 0xC00, 0xE00, 0xF00, 0xF80, 0xFC0, 0xFE0, 0xFFF, 0xE380,
@@ -116,6 +121,11 @@ static void fb_fill_rect_raw(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uin
     if (x + w > g_fb_width) w = g_fb_width - x;
     if (y + h > g_fb_height) h = g_fb_height - y;
 
+    if (g_fb_bpp == 32) {
+        stream_fill_rect32(g_fb + y * g_fb_pitch + x * 4u, g_fb_pitch, w, h, rgb & 0xFFFFFFu);
+        return;
+    }
+
     for (uint32_t py = 0; py < h; py++) {
         for (uint32_t px = 0; px < w; px++) {
             fb_putpixel(x + px, y + py, rgb);
@@ -123,6 +133,25 @@ static void fb_fill_rect_raw(uint32_t x, uint32_t y, uint32_t w, uint32_t h, uin
     }
 }
 
+static void fb_blit_raw(uint32_t x, uint32_t y, uint32_t w, uint32_t h,
+                        const uint32_t* src, uint32_t stride) {
+    if (!g_fb || w == 0 || h == 0) return;
+    if (x >= g_fb_width || y >= g_fb_height) return;
+    if (x + w > g_fb_width) w = g_fb_width - x;
+    if (y + h > g_fb_height) h = g_fb_height - y;
+
+    if (g_fb_bpp == 32) {
+        stream_copy_rect(g_fb + y * g_fb_pitch + x * 4u, g_fb_pitch, src, stride * 4u, w * 4u, h);
+        return;
+    }
+
+    for (uint32_t py = 0; py < h; py++) {
+        for (uint32_t px = 0; px < w; px++) {
+            fb_putpixel(x + px, y + py, src[py * stride + px]);
+        }
+    }
+}
+
 static void fb_mouse_hide(void) {
     if (!g_mouse_visible || !g_fb) return;
 
@@ -242,7 +271,8 @@ static uint8_t glyph_row_bits(char ch, uint8_t row) {
     }
 }
 
-static void fb_draw_cell(uint16_t row, uint16_t col, char ch, uint8_t attr) {
+static void fb_render_cell(uint32_t* out, uint32_t stride, uint16_t row, uint16_t col,
+                           char ch, uint8_t attr) {
     uint8_t bg_idx = (uint8_t)((attr >> 4) & 0x0F);
     uint32_t bg = palette_color(bg_idx);
     uint32_t fg = palette_color(attr & 0x0F);
@@ -250,11 +280,12 @@ static void fb_draw_cell(uint16_t row, uint16_t col, char ch, uint8_t attr) {
     uint32_t y0 = (uint32_t)row * FB_CELL_H;
 
     for (uint32_t py = 0; py < FB_CELL_H; py++) {
+        uint32_t* line = out + py * stride;
         for (uint32_t px = 0; px < FB_CELL_W; px++) {
             if (g_desktop_enabled && bg_idx == 0) {
-                fb_putpixel(x0 + px, y0 + py, desktop_color_at(x0 + px, y0 + py));
+                line[px] = desktop_color_at(x0 + px, y0 + py);
             } else {
-                fb_putpixel(x0 + px, y0 + py, bg);
+                line[px] = bg;
             }
         }
     }
@@ -263,23 +294,44 @@ static void fb_draw_cell(uint16_t row, uint16_t col, char ch, uint8_t attr) {
 
     for (uint8_t gy = 0; gy < FB_GLYPH_H; gy++) {
         uint8_t bits = glyph_row_bits(ch, gy);
+        uint32_t* line = out + (1u + (uint32_t)gy * 2u) * stride;
         for (uint8_t gx = 0; gx < FB_GLYPH_W; gx++) {
             if ((bits & (1u << (FB_GLYPH_W - 1u - gx))) == 0) continue;
 
-            uint32_t px = x0 + 1u + gx;
-            uint32_t py = y0 + 1u + (uint32_t)gy * 2u;
-            fb_putpixel(px, py, fg);
-            fb_putpixel(px, py + 1u, fg);
-            if (px + 1u < x0 + FB_CELL_W - 1u) {
-                fb_putpixel(px + 1u, py, fg);
-                fb_putpixel(px + 1u, py + 1u, fg);
+            uint32_t px = 1u + gx;
+            line[px] = fg;
+            line[stride + px] = fg;
+            if (px + 1u < FB_CELL_W - 1u) {
+                line[px + 1u] = fg;
+                line[stride + px + 1u] = fg;
             }
         }
     }
 }
 
+static void fb_draw_cell(uint16_t row, uint16_t col, char ch, uint8_t attr) {
+    uint32_t cell[FB_CELL_H * FB_CELL_W];
+
+    fb_render_cell(cell, FB_CELL_W, row, col, ch, attr);
+    fb_blit_raw((uint32_t)col * FB_CELL_W, (uint32_t)row * FB_CELL_H,
+                FB_CELL_W, FB_CELL_H, cell, FB_CELL_W);
+}
+
+/* A whole text row is rendered into g_fb_band and pushed in one blit, which
+   is large enough to take the streaming path on 32bpp modes. */
+static void fb_draw_row(uint16_t row) {
+    uint32_t stride = (uint32_t)g_cols * FB_CELL_W;
+
+    for (uint16_t x = 0; x < g_cols; x++) {
+        fb_render_cell(g_fb_band + (uint32_t)x * FB_CELL_W, stride, row, x,
+                       g_chars[row][x], g_attrs[row][x]);
+    }
+    fb_blit_raw(0, (uint32_t)row * FB_CELL_H, stride, FB_CELL_H, g_fb_band, stride);
+}
+
 static void refresh_cell(uint16_t row, uint16_t col) {
     if (row >= g_rows || col >= g_cols) return;
+    if (g_redraw_pending) return;
 
     if (g_backend == VGA_BACKEND_TEXT) {
         VGA_TEXT_BUFFER[row * g_cols + col] = vga_entry(g_chars[row][col], g_attrs[row][col]);
@@ -295,16 +347,18 @@ static void refresh_all(void) {
     if (g_backend == VGA_BACKEND_FRAMEBUFFER) {
         g_fb_batch++;
         fb_mouse_hide();
+        for (uint16_t y = 0; y < g_rows; y++) {
+            fb_draw_row(y);
+        }
+        g_fb_batch--;
+        if (!g_fb_batch) fb_mouse_show();
+        return;
     }
     for (uint16_t y = 0; y < g_rows; y++) {
         for (uint16_t x = 0; x < g_cols; x++) {
             refresh_cell(y, x);
         }
     }
-    if (g_backend == VGA_BACKEND_FRAMEBUFFER) {
-        g_fb_batch--;
-        fb_mouse_show();
-    }
 }
 
 static void vga_update_hw_cursor(void) {
@@ -327,16 +381,16 @@ static void blank_row(uint16_t row) {
 static void vga_scroll_if_needed(void) {
     if (g_cursor_row < g_rows) return;
 
-    for (uint16_t y = 1; y < g_rows; y++) {
-        for (uint16_t x = 0; x < g_cols; x++) {
-            g_chars[y - 1][x] = g_chars[y][x];
-            g_attrs[y - 1][x] = g_attrs[y][x];
-        }
-    }
+    kmemmove(g_chars[0], g_chars[1], (size_t)(g_rows - 1u) * VGA_MAX_COLS);
+    kmemmove(g_attrs[0], g_attrs[1], (size_t)(g_rows - 1u) * VGA_MAX_COLS);
 
     blank_row((uint16_t)(g_rows - 1u));
     g_cursor_row = (uint16_t)(g_rows - 1u);
-    refresh_all();
+
+    /* Inside vga_write, scrolls only mark the screen; it is redrawn once
+       when the write finishes. */
+    if (g_write_depth) g_redraw_pending = 1;
+    else refresh_all();
 }
 
 void vga_init(const multiboot_info_t* mb) {
@@ -393,18 +447,16 @@ void vga_clear(void) {
     vga_update_hw_cursor();
 }
 
-void vga_putc(char ch) {
+static void put_char(char ch) {
     if (ch == '\n') {
         g_cursor_col = 0;
         g_cursor_row++;
         vga_scroll_if_needed();
-        vga_update_hw_cursor();
         return;
     }
 
     if (ch == '\r') {
         g_cursor_col = 0;
-        vga_update_hw_cursor();
         return;
     }
 
@@ -417,7 +469,6 @@ void vga_putc(char ch) {
         } else {
             g_cursor_col = next;
         }
-        vga_update_hw_cursor();
         return;
     }
 
@@ -435,14 +486,40 @@ void vga_putc(char ch) {
         g_cursor_row++;
         vga_scroll_if_needed();
     }
+}
 
+void vga_putc(char ch) {
+    put_char(ch);
     vga_update_hw_cursor();
 }
 
-void vga_puts(const char* s) {
-    while (s && *s) {
-        vga_putc(*s++);
+void vga_write(const char* s, size_t n) {
+    if (!s || n == 0) return;
+
+    if (g_backend == VGA_BACKEND_FRAMEBUFFER) {
+        g_fb_batch++;
+        fb_mouse_hide();
+    }
+    g_write_depth++;
+
+    for (size_t i = 0; i < n; i++) {
+        put_char(s[i]);
+    }
+
+    g_write_depth--;
+    if (g_write_depth == 0 && g_redraw_pending) {
+        g_redraw_pending = 0;
+        refresh_all();
+    }
+    if (g_backend == VGA_BACKEND_FRAMEBUFFER) {
+        g_fb_batch--;
+        if (!g_fb_batch) fb_mouse_show();
     }
+    vga_update_hw_cursor();
+}
+
+void vga_puts(const char* s) {
+    if (s) vga_write(s, kstrlen(s));
 }
 
 void vga_backspace(void) {
@@ -507,6 +584,13 @@ void vga_fill_rect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint32_t rgb)
     if (!g_fb_batch) fb_mouse_show();
 }
 
+void vga_blit(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint32_t* src, uint32_t stride) {
+    if (g_backend != VGA_BACKEND_FRAMEBUFFER || !src) return;
+    if (!g_fb_batch) fb_mouse_hide();
+    fb_blit_raw(x, y, w, h, src, stride);
+    if (!g_fb_batch) fb_mouse_show();
+}
+
 void vga_desktop_enable(int enabled) {
     g_desktop_enabled = enabled != 0;
     if (g_backend == VGA_BACKEND_FRAMEBUFFER) {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 
 typedef struct multiboot_info multiboot_info_t;
@@ -8,6 +9,7 @@ void vga_init(const multiboot_info_t* mb);
 void vga_clear(void);
 void vga_puts(const char* s);
 void vga_putc(char c);
+void vga_write(const char* s, size_t n);
 void vga_backspace(void);
 
 uint16_t vga_cols(void);
@@ -22,6 +24,7 @@ int vga_is_framebuffer(void);
 uint16_t vga_pixel_width(void);
 uint16_t vga_pixel_height(void);
 void vga_fill_rect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint32_t rgb);
+void vga_blit(uint16_t x, uint16_t y, uint16_t w, uint16_t h, const uint32_t* src, uint32_t stride);
 void vga_desktop_enable(int enabled);
 void vga_mouse_set(uint16_t x, uint16_t y, int visible);
 void vga_batch_begin(void);
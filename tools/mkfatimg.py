@@ -0,0 +1,352 @@
+#!/usr/bin/env python3
+import json, random, struct, sys
+
+SECTOR = 512
+PART_LBA = 2048
+FIXED_TIME = 0x0000      # 00:00:00
+FIXED_DATE = 0x5821      # 2024-01-01
+
+ATTR_DIR = 0x10
+ATTR_ARCHIVE = 0x20
+
+# Spec file (JSON):
+# {
+#   "type": "fat16" | "fat32",
+#   "size_mb": 64,
+#   "cluster_size": 2048,
+#   "root_entries": 512,                      (FAT16 only)
+#   "seed": 1,
+#   "fragment": {"chance": 0.5, "max_extent": 4, "max_gap": 8},
+#   "entries": [
+#     {"file": "/BIG.BIN", "size": 8388608, "fragment": true},
+#     {"dir": "/MANY", "files": 1000, "size": [512, 8192], "name": "F{:05d}.DAT"},
+#     {"dir": "/EMPTY", "capacity": 256}
+#   ]
+# }
+
+def fail(msg):
+    print("mkfatimg: " + msg)
+    sys.exit(1)
+
+def name83(name):
+    if name in (".", ".."):
+        return name.ljust(11).encode("ascii")
+    base, dot, ext = name.upper().partition(".")
+    if not base or len(base) > 8 or len(ext) > 3 or "." in ext:
+        fail("not an 8.3 name: " + name)
+    for ch in base + ext:
+        if ch in ' "*+,/:;<=>?[\\]|' or ord(ch) < 0x20 or ord(ch) > 0x7E:
+            fail("bad character in name: " + name)
+    return (base.ljust(8) + ext.ljust(3)).encode("ascii")
+
+class Dir:
+    def __init__(self):
+        self.children = {}
+        self.capacity = 0
+        self.clusters = []
+
+class File:
+    def __init__(self, size, fragment, seed):
+        self.size = size
+        self.fragment = fragment
+        self.seed = seed
+        self.clusters = []
+
+def lookup_dir(root, path):
+    node = root
+    for part in [p for p in path.split("/") if p]:
+        key = part.upper()
+        child = node.children.get(key)
+        if child is None:
+            child = Dir()
+            node.children[key] = child
+        if not isinstance(child, Dir):
+            fail("path component is a file: " + path)
+        node = child
+    return node
+
+def add_file(root, path, f):
+    parent, _, leaf = path.rpartition("/")
+    d = lookup_dir(root, parent)
+    key = leaf.upper()
+    name83(key)
+    if key in d.children:
+        fail("duplicate entry: " + path)
+    d.children[key] = f
+
+def pick_size(size, rnd):
+    if isinstance(size, list):
+        return rnd.randint(size[0], size[1])
+    return int(size)
+
+def build_tree(spec, rnd):
+    root = Dir()
+    frag = spec.get("fragment", {})
+    chance = float(frag.get("chance", 0.0))
+    counter = 0
+
+    def fragmented(entry):
+        if "fragment" in entry:
+            return bool(entry["fragment"])
+        return rnd.random() < chance
+
+    for entry in spec.get("entries", []):
+        if "file" in entry:
+            counter += 1
+            add_file(root, entry["file"], File(pick_size(entry.get("size", 0), rnd), fragmented(entry), counter))
+        elif "dir" in entry:
+            d = lookup_dir(root, entry["dir"])
+            d.capacity = max(d.capacity, int(entry.get("capacity", 0)))
+            pattern = entry.get("name", "F{:05d}.DAT")
+            for i in range(int(entry.get("files", 0))):
+                counter += 1
+                add_file(root, entry["dir"].rstrip("/") + "/" + pattern.format(i),
+                         File(pick_size(entry.get("size", 0), rnd), fragmented(entry), counter))
+        else:
+            fail("entry needs 'file' or 'dir': " + json.dumps(entry))
+    return root
+
+class Layout:
+    def __init__(self, spec):
+        self.fat32 = spec.get("type", "fat16").lower() == "fat32"
+        self.total = int(spec.get("size_mb", 64)) * 1024 * 1024 // SECTOR
+        csize = int(spec.get("cluster_size", 2048))
+        if csize % SECTOR or (csize // SECTOR) & (csize // SECTOR - 1) or csize // SECTOR > 128:
+            fail("cluster_size must be 512 * 2^n, at most 64 KiB")
+        self.spc = csize // SECTOR
+        self.csize = csize
+        self.nfats = 2
+        self.rsvd = 32 if self.fat32 else 1
+        self.root_entries = 0 if self.fat32 else int(spec.get("root_entries", 512))
+        self.root_secs = (self.root_entries * 32 + SECTOR - 1) // SECTOR
+
+        tmp1 = self.total - (self.rsvd + self.root_secs)
+        tmp2 = 256 * self.spc + self.nfats
+        if self.fat32:
+            tmp2 //= 2
+        self.fatsz = (tmp1 + tmp2 - 1) // tmp2
+
+        self.data_start = self.rsvd + self.nfats * self.fatsz + self.root_secs
+        self.clusters = (self.total - self.data_start) // self.spc
+        width = 4 if self.fat32 else 2
+        self.clusters = min(self.clusters, self.fatsz * SECTOR // width - 2)
+
+        if self.fat32 and self.clusters < 65525:
+            print("mkfatimg: warning: %d clusters is below the FAT32 minimum (65525)" % self.clusters)
+        if not self.fat32 and not (4085 <= self.clusters <= 65524):
+            print("mkfatimg: warning: %d clusters is outside the FAT16 range" % self.clusters)
+
+class Allocator:
+    def __init__(self, count, rnd, frag):
+        self.used = bytearray(count + 2)
+        self.used[0] = self.used[1] = 1
+        self.fat = [0] * (count + 2)
+        self.rnd = rnd
+        self.max_extent = max(1, int(frag.get("max_extent", 4)))
+        self.max_gap = max(1, int(frag.get("max_gap", 8)))
+        self.cursor = 2
+
+    def run_at(self, c, want):
+        end = self.used.find(1, c, c + want)
+        return want if end < 0 else end - c
+
+    def take(self, c, n, chain):
+        self.used[c:c + n] = b"\1" * n
+        chain.extend(range(c, c + n))
+
+    def next_free(self, c):
+        c = self.used.find(0, c)
+        if c < 0:
+            c = self.used.find(0, 2)
+        if c < 0:
+            fail("volume full")
+        return c
+
+    def contiguous(self, n, chain):
+        c = self.used.find(bytes(n), 2)
+        if c < 0:
+            self.scattered(n, chain)
+            return
+        self.take(c, n, chain)
+        self.cursor = max(self.cursor, c + n)
+
+    def scattered(self, n, chain):
+        c = self.cursor
+        while n > 0:
+            c = self.next_free(min(c + self.rnd.randint(1, self.max_gap), len(self.used) - 1))
+            got = self.run_at(c, min(n, self.rnd.randint(1, self.max_extent)))
+            self.take(c, got, chain)
+            n -= got
+            c += got
+        self.cursor = c
+
+    def alloc(self, n, fragment):
+        chain = []
+        if n == 0:
+            return chain
+        if fragment and n > 1:
+            self.scattered(n, chain)
+        else:
+            self.contiguous(n, chain)
+        return chain
+
+    def link(self, chain, eoc):
+        for a, b in zip(chain, chain[1:]):
+            self.fat[a] = b
+        if chain:
+            self.fat[chain[-1]] = eoc
+
+def dirent(name, attr, cluster, size):
+    return struct.pack("<11sBBBHHHHHHHI", name83(name), attr, 0, 0,
+                       FIXED_TIME, FIXED_DATE, FIXED_DATE, (cluster >> 16) & 0xFFFF,
+                       FIXED_TIME, FIXED_DATE, cluster & 0xFFFF, size)
+
+def allocate(node, lay, al, is_root):
+    entries = len(node.children) + (0 if is_root else 2)
+    entries = max(entries, node.capacity, 1)
+    if not is_root or lay.fat32:
+        per_cluster = lay.csize // 32
+        node.clusters = al.alloc((entries + per_cluster - 1) // per_cluster, False)
+        al.link(node.clusters, lay.eoc)
+    elif entries > lay.root_entries:
+        fail("root directory needs %d entries, root_entries is %d" % (entries, lay.root_entries))
+
+    for key in sorted(node.children):
+        child = node.children[key]
+        if isinstance(child, Dir):
+            allocate(child, lay, al, False)
+        else:
+            child.clusters = al.alloc((child.size + lay.csize - 1) // lay.csize, child.fragment)
+            al.link(child.clusters, lay.eoc)
+
+def write_at(out, lba, data):
+    out.seek(lba * SECTOR)
+    out.write(data)
+
+def cluster_lba(lay, c):
+    return PART_LBA + lay.data_start + (c - 2) * lay.spc
+
+def write_chain(out, lay, chain, data):
+    i = 0
+    while i < len(chain):
+        j = i + 1
+        while j < len(chain) and chain[j] == chain[j - 1] + 1:
+            j += 1
+        write_at(out, cluster_lba(lay, chain[i]), data[i * lay.csize:j * lay.csize])
+        i = j
+
+def emit(out, node, lay, parent_cluster, is_root, seed):
+    ents = []
+    self_cluster = node.clusters[0] if node.clusters else 0
+    if not is_root:
+        ents.append(dirent(".", ATTR_DIR, self_cluster, 0))
+        ents.append(dirent("..", ATTR_DIR, parent_cluster, 0))
+    for key in sorted(node.children):
+        child = node.children[key]
+        if isinstance(child, Dir):
+            ents.append(dirent(key, ATTR_DIR, child.clusters[0], 0))
+            emit(out, child, lay, 0 if is_root else self_cluster, False, seed)
+        else:
+            ents.append(dirent(key, ATTR_ARCHIVE, child.clusters[0] if child.clusters else 0, child.size))
+            if child.clusters:
+                data = random.Random(seed * 1000003 + child.seed).randbytes(child.size)
+                write_chain(out, lay, child.clusters, data)
+
+    blob = b"".join(ents)
+    if is_root and not lay.fat32:
+        write_at(out, PART_LBA + lay.rsvd + lay.nfats * lay.fatsz, blob)
+    else:
+        blob = blob.ljust(len(node.clusters) * lay.csize, b"\0")
+        write_chain(out, lay, node.clusters, blob)
+
+def boot_sector(lay, root_cluster):
+    bs = bytearray(SECTOR)
+    bs[0:3] = b"\xEB\x58\x90" if lay.fat32 else b"\xEB\x3C\x90"
+    bs[3:11] = b"DIELLOS "
+    small = lay.total if lay.total < 65536 else 0
+    struct.pack_into("<HBHBHHBHHHII", bs, 11, SECTOR, lay.spc, lay.rsvd, lay.nfats,
+                     lay.root_entries, small, 0xF8, 0 if lay.fat32 else lay.fatsz,
+                     63, 255, PART_LBA, 0 if small else lay.total)
+    if lay.fat32:
+        struct.pack_into("<IHHIHH", bs, 36, lay.fatsz, 0, 0, root_cluster, 1, 6)
+        struct.pack_into("<BBBI11s8s", bs, 64, 0x80, 0, 0x29, 0x4449454C, b"BENCH      ", b"FAT32   ")
+    else:
+        struct.pack_into("<BBBI11s8s", bs, 36, 0x80, 0, 0x29, 0x4449454C, b"BENCH      ", b"FAT16   ")
+    bs[510] = 0x55
+    bs[511] = 0xAA
+    return bytes(bs)
+
+def fsinfo(free, next_free):
+    fs = bytearray(SECTOR)
+    struct.pack_into("<I", fs, 0, 0x41615252)
+    struct.pack_into("<III", fs, 484, 0x61417272, free, next_free)
+    fs[510] = 0x55
+    fs[511] = 0xAA
+    return bytes(fs)
+
+def mbr(lay):
+    m = bytearray(SECTOR)
+    ptype = 0x0C if lay.fat32 else 0x0E
+    struct.pack_into("<B3sB3sII", m, 446, 0x80, b"\xFE\xFF\xFF", ptype, b"\xFE\xFF\xFF", PART_LBA, lay.total)
+    m[510] = 0x55
+    m[511] = 0xAA
+    return bytes(m)
+
+def count_frag(node, acc):
+    for child in node.children.values():
+        if isinstance(child, Dir):
+            count_frag(child, acc)
+            continue
+        acc[0] += 1
+        breaks = sum(1 for a, b in zip(child.clusters, child.clusters[1:]) if b != a + 1)
+        if breaks:
+            acc[1] += 1
+            acc[2] += breaks
+
+def build(spec_path, out_path):
+    with open(spec_path, "r") as f:
+        spec = json.load(f)
+
+    seed = int(spec.get("seed", 0))
+    rnd = random.Random(seed)
+    lay = Layout(spec)
+    lay.eoc = 0x0FFFFFFF if lay.fat32 else 0xFFFF
+
+    root = build_tree(spec, rnd)
+    al = Allocator(lay.clusters, rnd, spec.get("fragment", {}))
+    allocate(root, lay, al, True)
+
+    free = sum(1 for c in range(2, lay.clusters + 2) if not al.used[c])
+    al.fat[0] = 0x0FFFFFF8 if lay.fat32 else 0xFFF8
+    al.fat[1] = 0x0FFFFFFF if lay.fat32 else 0xFFFF
+
+    with open(out_path, "wb") as out:
+        out.truncate((PART_LBA + lay.total) * SECTOR)
+        write_at(out, 0, mbr(lay))
+
+        bs = boot_sector(lay, root.clusters[0] if lay.fat32 else 0)
+        write_at(out, PART_LBA, bs)
+        if lay.fat32:
+            next_free = next((c for c in range(2, lay.clusters + 2) if not al.used[c]), 0xFFFFFFFF)
+            write_at(out, PART_LBA + 1, fsinfo(free, next_free))
+            write_at(out, PART_LBA + 6, bs)
+            write_at(out, PART_LBA + 7, fsinfo(free, next_free))
+
+        fmt = "<%dI" if lay.fat32 else "<%dH"
+        fat = struct.pack(fmt % len(al.fat), *al.fat)
+        for i in range(lay.nfats):
+            write_at(out, PART_LBA + lay.rsvd + i * lay.fatsz, fat)
+
+        emit(out, root, lay, 0, True, seed)
+
+    acc = [0, 0, 0]
+    count_frag(root, acc)
+    print("%s: %s, %d MiB, %d B clusters, %d clusters (%d free), %d files, %d fragmented, %d run breaks" % (
+        out_path, "FAT32" if lay.fat32 else "FAT16", lay.total * SECTOR // (1024 * 1024), lay.csize,
+        lay.clusters, free, acc[0], acc[1], acc[2]))
+
+if __name__ == "__main__":
+    if len(sys.argv) != 3:
+        print("usage: mkfatimg.py <spec.json> <out.img>")
+        sys.exit(1)
+    build(sys.argv[1], sys.argv[2])
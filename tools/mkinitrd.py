@@ -2,13 +2,106 @@
 import os, struct, sys
 
 MAGIC = 0x44495244  # 'DIRD'
+MAGIC_LZ4 = 0x5A524944  # 'DIRZ'
+MAGIC_V2 = 0x32524944  # 'DIR2'
 NAME_SIZE = 32
+NAME_MAX_V2 = 63
+LZ4_BLOCK = 16384
+PAGE = 4096
+
+V2_HEADER = "<8I"
+V2_ENTRY = "<IIIHHIIII"
+V2_F_CRC32C = 0x1
+V2_E_LZ4 = 0x1
 
 def pack_name(name: str) -> bytes:
     b = name.encode("ascii", errors="ignore")[:NAME_SIZE-1]
     return b + b"\x00" * (NAME_SIZE - len(b))
 
-def build(initrd_root: str, out_path: str):
+def lz4_len(out: bytearray, n: int):
+    while n >= 255:
+        out.append(255)
+        n -= 255
+    out.append(n)
+
+def lz4_sequence(out: bytearray, lit: bytes, off: int, mlen: int):
+    ml = mlen - 4 if mlen else 0
+    out.append((min(len(lit), 15) << 4) | min(ml, 15))
+    if len(lit) >= 15:
+        lz4_len(out, len(lit) - 15)
+    out += lit
+    if mlen:
+        out += struct.pack("<H", off)
+        if ml >= 15:
+            lz4_len(out, ml - 15)
+
+def lz4_block(data: bytes) -> bytes:
+    # Greedy single-probe matcher; the decoder only needs a valid block.
+    n = len(data)
+    out = bytearray()
+    table = {}
+    anchor = 0
+    i = 0
+    while i < n - 12:
+        key = data[i:i+4]
+        cand = table.get(key)
+        table[key] = i
+        if cand is None or i - cand > 0xFFFF:
+            i += 1
+            continue
+        mlen = 4
+        limit = n - 5 - i
+        while mlen < limit and data[cand + mlen] == data[i + mlen]:
+            mlen += 1
+        lz4_sequence(out, data[anchor:i], i - cand, mlen)
+        i += mlen
+        anchor = i
+    lz4_sequence(out, data[anchor:], 0, 0)
+    return bytes(out)
+
+def lz4_file(data: bytes) -> bytes:
+    blocks = []
+    for off in range(0, len(data), LZ4_BLOCK):
+        raw = data[off:off+LZ4_BLOCK]
+        packed = lz4_block(raw)
+        blocks.append(packed if len(packed) < len(raw) else raw)
+
+    out = bytearray(struct.pack("<II", LZ4_BLOCK, len(blocks)))
+    end = 0
+    for b in blocks:
+        end += len(b)
+        out += struct.pack("<I", end)
+    for b in blocks:
+        out += b
+    return bytes(out)
+
+def fnv1a(b: bytes) -> int:
+    h = 2166136261
+    for c in b:
+        h = ((h ^ c) * 16777619) & 0xFFFFFFFF
+    return h
+
+def _crc32c_table():
+    table = []
+    for i in range(256):
+        crc = i
+        for _ in range(8):
+            crc = (crc >> 1) ^ (0x82F63B78 if crc & 1 else 0)
+        table.append(crc)
+    return table
+
+CRC32C_TABLE = _crc32c_table()
+
+def crc32c(data: bytes) -> int:
+    crc = 0xFFFFFFFF
+    for c in data:
+        crc = (crc >> 8) ^ CRC32C_TABLE[(crc ^ c) & 0xFF]
+    return crc ^ 0xFFFFFFFF
+
+def align(n: int, a: int) -> int:
+    return (n + a - 1) & ~(a - 1)
+
+def collect(initrd_root: str):
     files = []
     for entry in sorted(os.listdir(initrd_root)):
         p = os.path.join(initrd_root, entry)
@@ -16,7 +109,65 @@ def build(initrd_root: str, out_path: str):
             with open(p, "rb") as f:
                 data = f.read()
             files.append((entry, data))
+    return files
+
+def build_v2(files, out_path: str, lz4: bool, crc: bool):
+    n = len(files)
+    nbuckets = 1
+    while nbuckets < max(n, 1):
+        nbuckets *= 2
+
+    names = bytearray()
+    entries = []
+    for name, data in files:
+        raw = name.encode("ascii", errors="ignore")
+        if len(raw) > NAME_MAX_V2:
+            sys.exit("mkinitrd: name longer than %d bytes: %s" % (NAME_MAX_V2, name))
+        payload = data
+        flags = 0
+        if lz4:
+            packed = lz4_file(data)
+            if len(packed) < len(data):
+                payload, flags = packed, V2_E_LZ4
+        entries.append({
+            "hash": fnv1a(raw), "next": 0, "name_off": len(names), "name_len": len(raw),
+            "flags": flags, "length": len(data), "payload": payload,
+            "crc": crc32c(payload) if crc else 0,
+        })
+        names += raw
+
+    buckets = [0] * nbuckets
+    for i, e in enumerate(entries):
+        b = e["hash"] & (nbuckets - 1)
+        e["next"] = buckets[b]
+        buckets[b] = i + 1
+
+    header_size = struct.calcsize(V2_HEADER)
+    buckets_off = header_size
+    entries_off = buckets_off + 4 * nbuckets
+    names_off = entries_off + struct.calcsize(V2_ENTRY) * n
+    offset = align(names_off + len(names), PAGE)
+
+    blob = bytearray()
+    for e in entries:
+        e["offset"] = offset
+        blob += e["payload"]
+        blob += b"\x00" * (align(len(e["payload"]), PAGE) - len(e["payload"]))
+        offset += align(len(e["payload"]), PAGE)
+
+    with open(out_path, "wb") as out:
+        out.write(struct.pack(V2_HEADER, MAGIC_V2, n, nbuckets, V2_F_CRC32C if crc else 0,
+                              buckets_off, entries_off, names_off, len(names)))
+        out.write(struct.pack("<%dI" % nbuckets, *buckets))
+        for e in entries:
+            out.write(struct.pack(V2_ENTRY, e["hash"], e["next"], e["name_off"], e["name_len"],
+                                  e["flags"], e["offset"], e["length"], len(e["payload"]), e["crc"]))
+        out.write(names)
+        out.write(b"\x00" * (align(names_off + len(names), PAGE) - names_off - len(names)))
+        out.write(blob)
 
+def build(initrd_root: str, out_path: str, lz4: bool = False):
+    files = collect(initrd_root)
     n = len(files)
     header_size = 8
     dirent_size = NAME_SIZE + 4 + 4
@@ -26,19 +177,25 @@ def build(initrd_root: str, out_path: str):
     dirents = []
     blob = bytearray()
     for name, data in files:
+        payload = lz4_file(data) if lz4 else data
         dirents.append((name, offset, len(data)))
-        blob += data
-        offset += len(data)
+        blob += payload
+        offset += len(payload)
 
     with open(out_path, "wb") as out:
-        out.write(struct.pack("<II", MAGIC, n))
+        out.write(struct.pack("<II", MAGIC_LZ4 if lz4 else MAGIC, n))
         for name, off, length in dirents:
             out.write(pack_name(name))
             out.write(struct.pack("<II", off, length))
         out.write(blob)
 
 if __name__ == "__main__":
-    if len(sys.argv) != 3:
-        print("usage: mkinitrd.py <initrd_root_dir> <out_file>")
+    flags = [a for a in sys.argv[1:] if a.startswith("--")]
+    args = [a for a in sys.argv[1:] if not a.startswith("--")]
+    if len(args) != 2 or any(f not in ("--v1", "--lz4", "--crc") for f in flags):
+        print("usage: mkinitrd.py [--v1] [--lz4] [--crc] <initrd_root_dir> <out_file>")
         sys.exit(1)
-    build(sys.argv[1], sys.argv[2])
+    if "--v1" in flags:
+        build(args[0], args[1], "--lz4" in flags)
+    else:
+        build_v2(collect(args[0]), args[1], "--lz4" in flags, "--crc" in flags)